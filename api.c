@@ -0,0 +1,126 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "bind.h"
+#include "check.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ts.h"
+#include "vendor/stretchy_buffer.h"
+
+struct TsModule {
+    Module *mod;
+};
+
+struct TsContext {
+    TsModule **modules;
+};
+
+TsContext *ts_context_create(void) {
+    TsContext *ctx = malloc(sizeof(TsContext));
+    ctx->modules = NULL;
+    return ctx;
+}
+
+void ts_context_destroy(TsContext *ctx) {
+    for (int i = 0; i < sb_count(ctx->modules); i++) {
+        module_destroy(ctx->modules[i]->mod);
+        free(ctx->modules[i]);
+    }
+    sb_free(ctx->modules);
+    free(ctx);
+}
+
+TsModule *ts_parse(TsContext *ctx, const char *source, size_t source_len) {
+    if (source_len > LEXER_MAX_SOURCE_LEN) {
+        return NULL;
+    }
+    Module *mod = module_create(source, source_len);
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+
+    TsModule *module = malloc(sizeof(TsModule));
+    module->mod = mod;
+    sb_push(ctx->modules, module);
+    return module;
+}
+
+bool ts_bind(TsModule *module) {
+    Module *mod = module->mod;
+    if (!mod->bound) {
+        module_bind(mod);
+    }
+    return sb_count(mod->bind_diagnostics) == 0;
+}
+
+bool ts_check(TsModule *module) {
+    ts_bind(module);
+    module_check(module->mod);
+    return sb_count(module->mod->check_diagnostics) == 0;
+}
+
+int ts_diagnostic_count(const TsModule *module) {
+    const Module *mod = module->mod;
+    return sb_count(mod->diagnostics) + sb_count(mod->bind_diagnostics) + sb_count(mod->check_diagnostics);
+}
+
+static TsDiagnosticKind ts_diagnostic_kind(DiagnosticKind kind) {
+    switch (kind) {
+        case DIAGNOSTIC_REDECLARATION:
+            return TS_DIAGNOSTIC_REDECLARATION;
+        case DIAGNOSTIC_TYPE:
+            return TS_DIAGNOSTIC_TYPE;
+        case DIAGNOSTIC_SYNTAX:
+        default:
+            return TS_DIAGNOSTIC_SYNTAX;
+    }
+}
+
+TsDiagnostic ts_diagnostic(const TsModule *module, int index) {
+    assert(index >= 0 && index < ts_diagnostic_count(module));
+    const Module *mod = module->mod;
+    Diagnostic *lists[] = {mod->diagnostics, mod->bind_diagnostics, mod->check_diagnostics};
+    int list = 0;
+    while (index >= sb_count(lists[list])) {
+        index -= sb_count(lists[list]);
+        list++;
+    }
+    const Diagnostic *diagnostic = &lists[list][index];
+    LineCol at = module_line_col(mod, diagnostic->location.pos);
+    TsDiagnostic result = {
+            .kind = ts_diagnostic_kind(diagnostic->kind),
+            .offset = diagnostic->location.pos,
+            .line = at.line,
+            .column = at.column,
+            .message = diagnostic->message,
+    };
+    return result;
+}
+
+int ts_symbol_count(const TsModule *module) {
+    const Module *mod = module->mod;
+    return mod->bound ? scope_symbol_count(mod->locals) : 0;
+}
+
+TsSymbol ts_symbol(const TsModule *module, int index) {
+    assert(index >= 0 && index < ts_symbol_count(module));
+    const Module *mod = module->mod;
+    const Symbol *symbol = &mod->locals->symbols[index];
+    InternedName name = interner_name(mod->names, symbol->name);
+    size_t pos = ast_location(&mod->ast, symbol->decls[0]).pos;
+    LineCol at = module_line_col(mod, pos);
+    TsSymbol result = {
+            .name = name.text,
+            .name_len = name.len,
+            .is_value = symbol->value_decl != AST_NONE,
+            .is_type = symbol->type_decl != AST_NONE,
+            .declarations = sb_count(symbol->decls),
+            .offset = pos,
+            .line = at.line,
+            .column = at.column,
+    };
+    return result;
+}
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+struct ArenaChunk_ {
+    ArenaChunk *next;
+    size_t size;
+    _Alignas(ARENA_ALIGN) char data[];
+};
+
+Arena *arena_create(void) {
+    Arena *arena = malloc(sizeof(Arena));
+    arena->chunks = NULL;
+    arena->cursor = NULL;
+    arena->end = NULL;
+    arena->allocations = 0;
+    arena->chunk_bytes = 0;
+    return arena;
+}
+
+static void arena_grow(Arena *arena, size_t size) {
+    size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + chunk_size);
+    chunk->size = chunk_size;
+    arena->chunk_bytes += chunk_size;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->cursor = chunk->data;
+    arena->end = chunk->data + chunk_size;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+    if ((size_t) (arena->end - arena->cursor) < size) {
+        arena_grow(arena, size);
+    }
+    void *ptr = arena->cursor;
+    arena->cursor += size;
+    arena->allocations++;
+    return ptr;
+}
+
+char *arena_strndup(Arena *arena, const char *str, size_t len) {
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+void arena_reset(Arena *arena) {
+    ArenaChunk *kept = arena->chunks;
+    if (kept == NULL) {
+        return;
+    }
+    ArenaChunk *chunk = kept->next;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    kept->next = NULL;
+    arena->cursor = kept->data;
+    arena->end = kept->data + kept->size;
+    arena->allocations = 0;
+    arena->chunk_bytes = kept->size;
+}
+
+void arena_absorb(Arena *dst, Arena *src) {
+    dst->allocations += src->allocations;
+    dst->chunk_bytes += src->chunk_bytes;
+
+    // Splice src's chunks in behind dst's current chunk so dst keeps
+    // bump-allocating from where it was.
+    ArenaChunk *last = src->chunks;
+    if (last != NULL) {
+        while (last->next != NULL) {
+            last = last->next;
+        }
+        if (dst->chunks == NULL) {
+            dst->chunks = src->chunks;
+        } else {
+            last->next = dst->chunks->next;
+            dst->chunks->next = src->chunks;
+        }
+    }
+    free(src);
+}
+
+void arena_destroy(Arena *arena) {
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
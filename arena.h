@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct ArenaChunk_ ArenaChunk;
+
+typedef struct {
+    ArenaChunk *chunks;
+    char *cursor;
+    char *end;
+    size_t allocations;
+    size_t chunk_bytes;
+} Arena;
+
+Arena *arena_create(void);
+
+void *arena_alloc(Arena *arena, size_t size);
+
+char *arena_strndup(Arena *arena, const char *str, size_t len);
+
+// Frees every allocation at once. The most recent chunk is kept for the
+// allocations that follow.
+void arena_reset(Arena *arena);
+
+// Moves every allocation in `src` into `dst` and frees `src`.
+void arena_absorb(Arena *dst, Arena *src);
+
+void arena_destroy(Arena *arena);
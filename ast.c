@@ -1,75 +1,152 @@
+#include <string.h>
+
 #include "ast.h"
+#include "vendor/stretchy_buffer.h"
 
-static int ident_next_id_ = 0;
-int ident_next_id() {
-    return ident_next_id_++;
-}
+#define AST_NO_NAME ((uint32_t) -1)
 
-Ident ident_create(char *text) {
-    Ident ident = { .text = text, .id = ident_next_id() };
+Ident ident_create(Span span, int id) {
+    Ident ident = {.span = span, .id = id};
     return ident;
 }
 
-Expr expr_ident_create(Location location, char *text) {
-    Expr expr;
-    expr.type = EXPR_IDENT;
-    expr.location = location;
-    Ident ident = ident_create(text);
-    expr.ident = ident;
-    return expr;
+void ast_init(Ast *ast) {
+    memset(ast, 0, sizeof(Ast));
+}
+
+void ast_free(Ast *ast) {
+    sb_free(ast->kinds);
+    sb_free(ast->locations);
+    sb_free(ast->data);
+    sb_free(ast->extra);
+    sb_free(ast->numbers);
+    ast_init(ast);
+}
+
+int ast_node_count(const Ast *ast) {
+    return sb_count(ast->kinds);
+}
+
+static NodeId ast_add(Ast *ast, NodeKind kind, Location location, uint32_t a, uint32_t b) {
+    NodeId node = (NodeId) sb_count(ast->kinds);
+    NodeData data = {.a = a, .b = b};
+    sb_push(ast->kinds, (uint8_t) kind);
+    sb_push(ast->locations, location);
+    sb_push(ast->data, data);
+    return node;
+}
+
+NodeId expr_ident_create(Ast *ast, Location location, int name) {
+    return ast_add(ast, NODE_EXPR_IDENT, location, (uint32_t) name, 0);
+}
+
+NodeId expr_num_create(Ast *ast, Location location, double value) {
+    uint32_t index = (uint32_t) sb_count(ast->numbers);
+    sb_push(ast->numbers, value);
+    return ast_add(ast, NODE_EXPR_NUM, location, index, 0);
 }
 
-Expr expr_num_create(Location location, double value) {
-    Expr expr;
-    expr.type = EXPR_NUM;
-    expr.location = location;
-    Number num = {.value = value};
-    expr.num = num;
-    return expr;
+NodeId expr_assignment_create(Ast *ast, Location location, int name, NodeId value) {
+    return ast_add(ast, NODE_EXPR_ASSIGNMENT, location, (uint32_t) name, value);
 }
 
-Expr expr_assignment_create(Location location, Ident name, Expr *value) {
-    Assignment assignment = {.expr = value, .name = name};
-    Expr expr = {
-            .type = EXPR_ASSIGNMENT,
-            .location = location,
-            .assignment = assignment,
-    };
-    return expr;
+NodeId decl_let_create(Ast *ast, Location location, int name, int type_name, NodeId init) {
+    uint32_t index = (uint32_t) sb_count(ast->extra);
+    sb_push(ast->extra, type_name < 0 ? AST_NO_NAME : (uint32_t) type_name);
+    sb_push(ast->extra, init);
+    return ast_add(ast, NODE_DECL_LET, location, (uint32_t) name, index);
 }
 
-Decl decl_let_create(Location location, Ident name, Ident *type_name, Expr init) {
-    Decl decl;
-    decl.type = DECL_LET;
-    decl.location = location;
+NodeId decl_type_alias_create(Ast *ast, Location location, int name, int type_name) {
+    return ast_add(ast, NODE_DECL_TYPE_ALIAS, location, (uint32_t) name, (uint32_t) type_name);
+}
+
+int node_name(const Ast *ast, NodeId node) {
+    return (int) ast->data[node].a;
+}
+
+double expr_num_value(const Ast *ast, NodeId node) {
+    return ast->numbers[ast->data[node].a];
+}
+
+NodeId expr_assignment_value(const Ast *ast, NodeId node) {
+    return ast->data[node].b;
+}
+
+int decl_let_type_name(const Ast *ast, NodeId node) {
+    uint32_t type_name = ast->extra[ast->data[node].b];
+    return type_name == AST_NO_NAME ? -1 : (int) type_name;
+}
 
-    Let let = {.name = name, .type_name = type_name, .init = init};
-    decl.let = let;
+NodeId decl_let_init(const Ast *ast, NodeId node) {
+    return ast->extra[ast->data[node].b + 1];
+}
 
-    return decl;
+int decl_type_alias_type_name(const Ast *ast, NodeId node) {
+    return (int) ast->data[node].b;
 }
 
-Decl decl_type_alias_create(Location location, Ident name, Ident type_name) {
-    Decl decl;
-    decl.type = DECL_TYPE_ALIAS;
-    decl.location = location;
-    TypeAlias type_alias = {.name = name, .type_name = type_name};
-    decl.type_alias = type_alias;
-    return decl;
+AstMark ast_mark(const Ast *ast) {
+    AstMark mark = {.nodes = sb_count(ast->kinds), .extra = sb_count(ast->extra), .numbers = sb_count(ast->numbers)};
+    return mark;
 }
 
-Stmt stmt_expr_create(Location location, Expr expr) {
-    Stmt stmt;
-    stmt.type = STMT_EXPR;
-    stmt.location = location;
-    stmt.expr = expr;
-    return stmt;
+void ast_truncate(Ast *ast, AstMark mark) {
+    if (ast->kinds != NULL) {
+        stb__sbn(ast->kinds) = mark.nodes;
+        stb__sbn(ast->locations) = mark.nodes;
+        stb__sbn(ast->data) = mark.nodes;
+    }
+    if (ast->extra != NULL) {
+        stb__sbn(ast->extra) = mark.extra;
+    }
+    if (ast->numbers != NULL) {
+        stb__sbn(ast->numbers) = mark.numbers;
+    }
 }
 
-Stmt stmt_decl_create(Location location, Decl decl) {
-    Stmt stmt;
-    stmt.type = STMT_DECL;
-    stmt.location = location;
-    stmt.decl = decl;
-    return stmt;
+NodeId ast_append(Ast *dst, const Ast *src, const int *remap) {
+    NodeId offset = (NodeId) ast_node_count(dst);
+    uint32_t numbers_offset = (uint32_t) sb_count(dst->numbers);
+
+    int count = ast_node_count(src);
+    if (count == 0) {
+        return offset;
+    }
+    memcpy(sb_add(dst->kinds, count), src->kinds, sizeof(uint8_t) * count);
+    memcpy(sb_add(dst->locations, count), src->locations, sizeof(Location) * count);
+    if (sb_count(src->numbers) > 0) {
+        memcpy(sb_add(dst->numbers, sb_count(src->numbers)), src->numbers, sizeof(double) * sb_count(src->numbers));
+    }
+
+    NodeData *data = sb_add(dst->data, count);
+    for (int i = 0; i < count; i++) {
+        NodeData d = src->data[i];
+        switch ((NodeKind) src->kinds[i]) {
+            case NODE_EXPR_IDENT:
+                d.a = (uint32_t) remap[d.a];
+                break;
+            case NODE_EXPR_NUM:
+                d.a += numbers_offset;
+                break;
+            case NODE_EXPR_ASSIGNMENT:
+                d.a = (uint32_t) remap[d.a];
+                d.b += offset;
+                break;
+            case NODE_DECL_LET: {
+                uint32_t type_name = src->extra[d.b];
+                d.a = (uint32_t) remap[d.a];
+                sb_push(dst->extra, type_name == AST_NO_NAME ? AST_NO_NAME : (uint32_t) remap[type_name]);
+                sb_push(dst->extra, src->extra[d.b + 1] + offset);
+                d.b = (uint32_t) sb_count(dst->extra) - 2;
+                break;
+            }
+            case NODE_DECL_TYPE_ALIAS:
+                d.a = (uint32_t) remap[d.a];
+                d.b = (uint32_t) remap[d.b];
+                break;
+        }
+        data[i] = d;
+    }
+    return offset;
 }
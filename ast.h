@@ -1,109 +1,112 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "span.h"
 
 typedef struct {
     size_t pos;
 } Location;
 
-typedef enum {
-    EXPR_IDENT,
-    EXPR_NUM,
-    EXPR_ASSIGNMENT,
-} ExprType;
-
-typedef struct Expr_ Expr;
-
 typedef struct {
-    char *text;
+    Span span;
     int id;
 } Ident;
 
-typedef struct {
-    double value;
-} Number;
+// Nodes are 32-bit indices into the Ast arrays. Children are always created
+// before their parents, so a node's children have smaller ids.
+typedef uint32_t NodeId;
 
-typedef struct {
-    Ident name;
-    Expr *expr;
-} Assignment;
-
-struct Expr_ {
-    ExprType type;
-    Location location;
-
-    union {
-        // EXPR_IDENT
-        Ident ident;
-        // EXPR_NUM
-        Number num;
-        // EXPR_ASSIGNMENT
-        Assignment assignment;
-    };
-};
+#define AST_NONE UINT32_MAX
 
 typedef enum {
-    DECL_LET,
-    DECL_TYPE_ALIAS,
-} DeclType;
+    // a: name
+    NODE_EXPR_IDENT,
+    // a: index into numbers
+    NODE_EXPR_NUM,
+    // a: name, b: value
+    NODE_EXPR_ASSIGNMENT,
+    // a: name, b: index into extra of [type name or AST_NONE, init]
+    NODE_DECL_LET,
+    // a: name, b: type name
+    NODE_DECL_TYPE_ALIAS,
+} NodeKind;
 
 typedef struct {
-    Ident name;
-    Ident *type_name;
-    Expr init;
-} Let;
+    uint32_t a;
+    uint32_t b;
+} NodeData;
 
+// Struct-of-arrays node pool: one byte of kind, a location and two 32-bit
+// operands per node, with side tables for payloads that don't fit.
 typedef struct {
-    Ident name;
-    Ident type_name;
-} TypeAlias;
+    uint8_t *kinds;
+    Location *locations;
+    NodeData *data;
+    uint32_t *extra;
+    double *numbers;
+} Ast;
 
-typedef struct {
-    DeclType type;
-    Location location;
+Ident ident_create(Span span, int id);
 
-    union {
-        // DECL_LET
-        Let let;
-        // DECL_TYPE_ALIAS
-        TypeAlias type_alias;
-    };
-} Decl;
+void ast_init(Ast *ast);
 
-typedef enum {
-    STMT_EXPR,
-    STMT_DECL,
-} StmtType;
+void ast_free(Ast *ast);
 
-typedef struct {
-    StmtType type;
-    Location location;
+int ast_node_count(const Ast *ast);
 
-    union {
-        // STMT_EXPR
-        Expr expr;
-        // STMT_DECL
-        Decl decl;
-    };
-} Stmt;
+static inline NodeKind ast_kind(const Ast *ast, NodeId node) {
+    return (NodeKind) ast->kinds[node];
+}
 
-typedef struct {
-    char *id;
-} Type;
+static inline Location ast_location(const Ast *ast, NodeId node) {
+    return ast->locations[node];
+}
+
+static inline bool ast_is_decl(const Ast *ast, NodeId node) {
+    NodeKind kind = ast_kind(ast, node);
+    return kind == NODE_DECL_LET || kind == NODE_DECL_TYPE_ALIAS;
+}
+
+NodeId expr_ident_create(Ast *ast, Location location, int name);
+
+NodeId expr_num_create(Ast *ast, Location location, double value);
+
+NodeId expr_assignment_create(Ast *ast, Location location, int name, NodeId value);
 
-Ident ident_create(char *text);
+NodeId decl_let_create(Ast *ast, Location location, int name, int type_name, NodeId init);
 
-Expr expr_ident_create(Location location, char *text);
+NodeId decl_type_alias_create(Ast *ast, Location location, int name, int type_name);
 
-Expr expr_num_create(Location location, double value);
+// The name introduced by a declaration, or bound by an identifier or
+// assignment expression.
+int node_name(const Ast *ast, NodeId node);
 
-Expr expr_assignment_create(Location location, Ident name, Expr *value);
+double expr_num_value(const Ast *ast, NodeId node);
 
-Decl decl_let_create(Location location, Ident name, Ident *type_name, Expr init);
+NodeId expr_assignment_value(const Ast *ast, NodeId node);
 
-Decl decl_type_alias_create(Location location, Ident name, Ident type_name);
+// -1 if the let has no annotation.
+int decl_let_type_name(const Ast *ast, NodeId node);
+
+NodeId decl_let_init(const Ast *ast, NodeId node);
+
+int decl_type_alias_type_name(const Ast *ast, NodeId node);
+
+// A point in the node pool that it can be truncated back to.
+typedef struct {
+    int nodes;
+    int extra;
+    int numbers;
+} AstMark;
 
-Stmt stmt_expr_create(Location location, Expr expr);
+AstMark ast_mark(const Ast *ast);
 
-Stmt stmt_decl_create(Location location, Decl decl);
+// Drops every node created since `mark`, along with its payloads.
+void ast_truncate(Ast *ast, AstMark mark);
 
+// Appends every node of `src` to `dst`, rewriting name ids through `remap`.
+// Returns the id offset to add to `src` node ids.
+NodeId ast_append(Ast *dst, const Ast *src, const int *remap);
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench/generate.h"
+#include "bind.h"
+#include "lexer.h"
+#include "parser.h"
+#include "source.h"
+#include "tokens.h"
+#include "vendor/stretchy_buffer.h"
+
+// Emits one JSON object per line:
+//   {"benchmark": "lexer_scan", "input": "mixed", "bytes": ..., "seconds": ..., ...}
+// Each phase reports the best of --runs runs.
+
+typedef struct {
+    const char *name;
+    const char *data;
+    size_t len;
+} BenchInput;
+
+static int bench_runs = 5;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static Module *parse_input(const BenchInput *input, TokenMode token_mode) {
+    Module *mod = module_create(input->data, input->len);
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    parser->token_mode = token_mode;
+    parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return mod;
+}
+
+static void bench_lexer(const BenchInput *input) {
+    double best = 0;
+    size_t tokens = 0;
+    for (int run = 0; run < bench_runs; run++) {
+        Module *mod = module_create(input->data, input->len);
+        Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+
+        Token batch[256];
+        double start = now_seconds();
+        tokens = 0;
+        size_t count;
+        do {
+            count = lexer_scan_batch(lexer, batch, 256);
+            tokens += count;
+        } while (batch[count - 1].type != TOK_END_OF_FILE);
+        double elapsed = now_seconds() - start;
+
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        lexer_destroy(lexer);
+        module_destroy(mod);
+    }
+
+    printf("{\"benchmark\": \"lexer_scan\", \"input\": \"%s\", \"bytes\": %zu, \"tokens\": %zu, "
+           "\"seconds\": %.6f, \"mb_per_s\": %.2f, \"tokens_per_s\": %.0f}\n",
+           input->name, input->len, tokens, best,
+           (double) input->len / best / 1e6, (double) tokens / best);
+}
+
+static void bench_parser(const BenchInput *input, TokenMode token_mode) {
+    double best = 0;
+    int statements = 0;
+    for (int run = 0; run < bench_runs; run++) {
+        double start = now_seconds();
+        Module *mod = parse_input(input, token_mode);
+        double elapsed = now_seconds() - start;
+
+        statements = sb_count(mod->statements);
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        module_destroy(mod);
+    }
+
+    printf("{\"benchmark\": \"parser_parse\", \"input\": \"%s\", \"token_mode\": \"%s\", \"bytes\": %zu, "
+           "\"statements\": %d, \"seconds\": %.6f, \"mb_per_s\": %.2f, \"statements_per_s\": %.0f}\n",
+           input->name, token_mode_name(token_mode), input->len, statements, best,
+           (double) input->len / best / 1e6, (double) statements / best);
+}
+
+static void bench_bind(const BenchInput *input) {
+    double best = 0;
+    int symbols = 0;
+    for (int run = 0; run < bench_runs; run++) {
+        Module *mod = parse_input(input, TOKEN_MODE_LAZY);
+
+        double start = now_seconds();
+        module_bind(mod);
+        double elapsed = now_seconds() - start;
+
+        symbols = scope_symbol_count(mod->locals);
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        module_destroy(mod);
+    }
+
+    printf("{\"benchmark\": \"module_bind\", \"input\": \"%s\", \"bytes\": %zu, \"symbols\": %d, "
+           "\"seconds\": %.6f, \"symbols_per_s\": %.0f}\n",
+           input->name, input->len, symbols, best, (double) symbols / best);
+}
+
+static void bench_input(const BenchInput *input) {
+    bench_lexer(input);
+    for (TokenMode mode = TOKEN_MODE_LAZY; mode <= TOKEN_MODE_PIPELINE; mode++) {
+        bench_parser(input, mode);
+    }
+    bench_bind(input);
+    fflush(stdout);
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: bench [--shape=NAME]... [--size=BYTES] [--seed=N] [--chain=N] [--runs=N] [FILE]...\n"
+            "With no shapes or files, runs every generated shape.\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    GenOptions options = gen_options_default();
+    bool shapes[GEN_SHAPE_COUNT] = {false};
+    bool any_shape = false;
+    const char **paths = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--shape=", 8) == 0) {
+            GenShape shape;
+            if (!gen_shape_parse(argv[i] + 8, &shape)) {
+                usage();
+            }
+            shapes[shape] = true;
+            any_shape = true;
+        } else if (strncmp(argv[i], "--size=", 7) == 0) {
+            options.size = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            options.seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--chain=", 8) == 0) {
+            options.chain_length = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--runs=", 7) == 0) {
+            bench_runs = atoi(argv[i] + 7);
+        } else if (argv[i][0] == '-') {
+            usage();
+        } else {
+            sb_push(paths, argv[i]);
+        }
+    }
+    if (bench_runs < 1) {
+        usage();
+    }
+
+    for (int i = 0; i < sb_count(paths); i++) {
+        SourceFile file;
+        if (!source_file_open(&file, paths[i])) {
+            perror(paths[i]);
+            return 1;
+        }
+        BenchInput input = {.name = paths[i], .data = file.data, .len = file.len};
+        bench_input(&input);
+        source_file_close(&file);
+    }
+
+    if (!any_shape && sb_count(paths) == 0) {
+        for (int i = 0; i < GEN_SHAPE_COUNT; i++) {
+            shapes[i] = true;
+        }
+    }
+    for (int i = 0; i < GEN_SHAPE_COUNT; i++) {
+        if (!shapes[i]) {
+            continue;
+        }
+        options.shape = (GenShape) i;
+        size_t len;
+        char *source = gen_source(&options, &len);
+        BenchInput input = {.name = gen_shape_name(options.shape), .data = source, .len = len};
+        bench_input(&input);
+        free(source);
+    }
+
+    sb_free(paths);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench/generate.h"
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: gen [--shape=mixed|lets|chains|aliases|reuse|numbers] [--size=BYTES] [--seed=N] [--chain=N]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    GenOptions options = gen_options_default();
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--shape=", 8) == 0) {
+            if (!gen_shape_parse(argv[i] + 8, &options.shape)) {
+                usage();
+            }
+        } else if (strncmp(argv[i], "--size=", 7) == 0) {
+            options.size = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            options.seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--chain=", 8) == 0) {
+            options.chain_length = atoi(argv[i] + 8);
+        } else {
+            usage();
+        }
+    }
+
+    size_t len;
+    char *source = gen_source(&options, &len);
+    fwrite(source, 1, len, stdout);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench/generate.h"
+
+// Names that GEN_SHAPE_REUSE initializers keep referring back to.
+#define GEN_REUSE_VOCABULARY 64
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    uint64_t rng;
+} GenBuffer;
+
+static uint64_t gen_next(GenBuffer *buf) {
+    // xorshift64*
+    buf->rng ^= buf->rng >> 12;
+    buf->rng ^= buf->rng << 25;
+    buf->rng ^= buf->rng >> 27;
+    return buf->rng * 0x2545f4914f6cdd1d;
+}
+
+static void gen_printf(GenBuffer *buf, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void gen_printf(GenBuffer *buf, const char *fmt, ...) {
+    while (true) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, args);
+        va_end(args);
+        if ((size_t) n < buf->cap - buf->len) {
+            buf->len += (size_t) n;
+            return;
+        }
+        buf->cap *= 2;
+        buf->data = realloc(buf->data, buf->cap);
+    }
+}
+
+GenOptions gen_options_default(void) {
+    GenOptions options = {
+            .shape = GEN_SHAPE_MIXED,
+            .size = 16 * 1024 * 1024,
+            .seed = 1,
+            .chain_length = 64,
+    };
+    return options;
+}
+
+const char *gen_shape_name(GenShape shape) {
+    switch (shape) {
+        case GEN_SHAPE_MIXED:
+            return "mixed";
+        case GEN_SHAPE_LETS:
+            return "lets";
+        case GEN_SHAPE_CHAINS:
+            return "chains";
+        case GEN_SHAPE_ALIASES:
+            return "aliases";
+        case GEN_SHAPE_REUSE:
+            return "reuse";
+        case GEN_SHAPE_NUMBERS:
+            return "numbers";
+        default:
+            return "(unknown)";
+    }
+}
+
+bool gen_shape_parse(const char *name, GenShape *shape) {
+    for (int i = 0; i < GEN_SHAPE_COUNT; i++) {
+        if (strcmp(name, gen_shape_name((GenShape) i)) == 0) {
+            *shape = (GenShape) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void gen_let(GenBuffer *buf, int i) {
+    if (gen_next(buf) % 2 == 0) {
+        gen_printf(buf, "let value_%d: number = %u;\n", i, (unsigned) (gen_next(buf) % 1000000));
+    } else {
+        gen_printf(buf, "let value_%d = %u;\n", i, (unsigned) (gen_next(buf) % 1000000));
+    }
+}
+
+static void gen_chain(GenBuffer *buf, int i, int chain_length) {
+    for (int j = 0; j < chain_length; j++) {
+        gen_printf(buf, "link_%d_%d = ", i, j);
+    }
+    gen_printf(buf, "%d;\n", i);
+}
+
+static void gen_alias(GenBuffer *buf, int i) {
+    // Each alias points at an earlier one, building long resolution chains.
+    if (i == 0) {
+        gen_printf(buf, "type Alias_0 = number;\n");
+    } else {
+        gen_printf(buf, "type Alias_%d = Alias_%u;\n", i, (unsigned) (i - 1 - gen_next(buf) % (i < 8 ? i : 8)));
+    }
+}
+
+static void gen_reuse(GenBuffer *buf, int i) {
+    unsigned a = (unsigned) (gen_next(buf) % GEN_REUSE_VOCABULARY);
+    unsigned b = (unsigned) (gen_next(buf) % GEN_REUSE_VOCABULARY);
+    if (i < GEN_REUSE_VOCABULARY) {
+        gen_printf(buf, "let v%d = %d;\n", i, i);
+    } else {
+        gen_printf(buf, "v%u = v%u = v%u;\n", a, b, (a + b) % GEN_REUSE_VOCABULARY);
+    }
+}
+
+static void gen_number(GenBuffer *buf, int i) {
+    // Data tables: mostly integers and short decimals, with every other
+    // literal form mixed in.
+    unsigned a = (unsigned) (gen_next(buf) % 1000000);
+    unsigned b = (unsigned) (gen_next(buf) % 1000);
+    switch (gen_next(buf) % 8) {
+        case 0:
+        case 1:
+        case 2:
+            gen_printf(buf, "let n%d = %u;\n", i, a);
+            break;
+        case 3:
+        case 4:
+            gen_printf(buf, "let n%d = %u.%03u;\n", i, a, b);
+            break;
+        case 5:
+            gen_printf(buf, "let n%d = %u.%ue-%u;\n", i, a % 10, a, b % 300);
+            break;
+        case 6:
+            gen_printf(buf, "let n%d = 0x%x;\n", i, a * 2654435761u);
+            break;
+        default:
+            gen_printf(buf, "let n%d = %u_%03u_%03u;\n", i, b % 999 + 1, a % 1000, a / 1000);
+            break;
+    }
+}
+
+char *gen_source(const GenOptions *options, size_t *len) {
+    GenBuffer buf = {
+            .data = malloc(options->size + 4096),
+            .len = 0,
+            .cap = options->size + 4096,
+            .rng = options->seed != 0 ? options->seed : 1,
+    };
+
+    // Each shape numbers its own statements so mixed output still declares
+    // every alias and vocabulary name it refers to.
+    int counts[GEN_SHAPE_COUNT] = {0};
+    for (int n = 0; buf.len < options->size; n++) {
+        GenShape shape = options->shape;
+        if (shape == GEN_SHAPE_MIXED) {
+            shape = (GenShape) (GEN_SHAPE_LETS + n % (GEN_SHAPE_COUNT - 1));
+        }
+        int i = counts[shape]++;
+
+        switch (shape) {
+            case GEN_SHAPE_LETS:
+                gen_let(&buf, i);
+                break;
+            case GEN_SHAPE_CHAINS:
+                gen_chain(&buf, i, options->shape == GEN_SHAPE_MIXED ? 4 : options->chain_length);
+                break;
+            case GEN_SHAPE_ALIASES:
+                gen_alias(&buf, i);
+                break;
+            case GEN_SHAPE_REUSE:
+                gen_reuse(&buf, i);
+                break;
+            case GEN_SHAPE_NUMBERS:
+                gen_number(&buf, i);
+                break;
+            default:
+                break;
+        }
+    }
+
+    *len = buf.len;
+    return buf.data;
+}
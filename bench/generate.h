@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    GEN_SHAPE_MIXED,
+    GEN_SHAPE_LETS,
+    GEN_SHAPE_CHAINS,
+    GEN_SHAPE_ALIASES,
+    GEN_SHAPE_REUSE,
+    GEN_SHAPE_NUMBERS,
+    GEN_SHAPE_COUNT,
+} GenShape;
+
+typedef struct {
+    GenShape shape;
+    // Approximate output size in bytes; generation stops at the first
+    // statement boundary past it.
+    size_t size;
+    uint64_t seed;
+    // Number of `=` links in each GEN_SHAPE_CHAINS statement.
+    int chain_length;
+} GenOptions;
+
+GenOptions gen_options_default(void);
+
+const char *gen_shape_name(GenShape shape);
+
+bool gen_shape_parse(const char *name, GenShape *shape);
+
+// Returns a malloc'd buffer of generated source. The same options always
+// produce the same bytes.
+char *gen_source(const GenOptions *options, size_t *len);
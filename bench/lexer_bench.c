@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bind.h"
+#include "lexer.h"
+#include "scan.h"
+#include "vendor/stretchy_buffer.h"
+
+#define LEXER_BENCH_RUNS 5
+#define LEXER_BENCH_DEFAULT_SIZE (16 * 1024 * 1024)
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static char *read_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *source = malloc(len + 1);
+    size_t read = fread(source, 1, len, file);
+    source[read] = '\0';
+    fclose(file);
+    return source;
+}
+
+// A keyword-heavy mix of lets, annotated lets, type aliases and assignments.
+static char *generate_source(size_t size) {
+    char *source = malloc(size + 128);
+    size_t len = 0;
+    for (int i = 0; len < size; i++) {
+        len += sprintf(source + len,
+                       "let value_%d: number = %d;\ntype Alias_%d = number;\nvalue_%d = other = %d;\n",
+                       i, i, i, i, i * 7);
+    }
+    return source;
+}
+
+// Generated-code shape: deep indentation, long mangled names and long literals.
+static char *generate_long_runs_source(size_t size) {
+    char *source = malloc(size + 256);
+    size_t len = 0;
+    for (int i = 0; len < size; i++) {
+        len += sprintf(source + len,
+                       "                        let __generated_module_binding_identifier_%08d ="
+                       " 1234567890123456789012345678901234%06d;\n",
+                       i, i);
+    }
+    return source;
+}
+
+static Token *lex_all(char *source, const ScanKernels *kernels) {
+    Module *mod = module_create(source, strlen(source));
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    lexer->kernels = kernels;
+
+    Token *tokens = lexer_tokenize(lexer);
+
+    lexer_destroy(lexer);
+    module_destroy(mod);
+    return tokens;
+}
+
+// Differential check: the vector kernels must produce exactly the token
+// stream the scalar ones do.
+static void check_kernels(char *source, const ScanKernels *kernels) {
+    Token *expected = lex_all(source, scan_kernels_scalar());
+    Token *actual = lex_all(source, kernels);
+    if (sb_count(expected) != sb_count(actual)) {
+        fprintf(stderr, "%s: %d tokens, scalar: %d tokens\n", kernels->name, sb_count(actual), sb_count(expected));
+        exit(1);
+    }
+    for (int i = 0; i < sb_count(expected); i++) {
+        Token a = actual[i];
+        Token e = expected[i];
+        bool same = a.type == TOK_NUMBER ? a.number == e.number : a.len == e.len && a.id == e.id;
+        if (a.type != e.type || a.offset != e.offset || !same) {
+            fprintf(stderr, "%s: token %d differs from scalar at offset %u\n", kernels->name, i, e.offset);
+            exit(1);
+        }
+    }
+    sb_free(expected);
+    sb_free(actual);
+}
+
+static void bench_lexer(const char *input_name, char *source, const ScanKernels *kernels) {
+    size_t source_len = strlen(source);
+    double best = 0;
+    size_t tokens = 0;
+    for (int run = 0; run < LEXER_BENCH_RUNS; run++) {
+        Module *mod = module_create(source, strlen(source));
+        Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+        lexer->kernels = kernels;
+
+        Token batch[256];
+        double start = now_seconds();
+        tokens = 0;
+        size_t count;
+        do {
+            count = lexer_scan_batch(lexer, batch, 256);
+            tokens += count;
+        } while (batch[count - 1].type != TOK_END_OF_FILE);
+        double elapsed = now_seconds() - start;
+
+        if (run == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        lexer_destroy(lexer);
+        module_destroy(mod);
+    }
+
+    printf("lexer_scan %s/%s: %zu bytes, %zu tokens, %.1f MB/s, %.1f Mtokens/s\n",
+           input_name,
+           kernels->name,
+           source_len,
+           tokens,
+           (double) source_len / best / 1e6,
+           (double) tokens / best / 1e6);
+}
+
+static void bench_input(const char *input_name, char *source) {
+    const ScanKernels *best = scan_kernels_best();
+    check_kernels(source, best);
+    bench_lexer(input_name, source, scan_kernels_scalar());
+    if (best != scan_kernels_scalar()) {
+        bench_lexer(input_name, source, best);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            char *source = read_file(argv[i]);
+            bench_input(argv[i], source);
+            free(source);
+        }
+        return 0;
+    }
+
+    char *source = generate_source(LEXER_BENCH_DEFAULT_SIZE);
+    bench_input("keywords", source);
+    free(source);
+
+    source = generate_long_runs_source(LEXER_BENCH_DEFAULT_SIZE);
+    bench_input("long-runs", source);
+    free(source);
+    return 0;
+}
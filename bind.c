@@ -1,61 +1,243 @@
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <sys/mman.h>
 
 #include "bind.h"
 #include "vendor/stretchy_buffer.h"
 
-BindResult module_bind(Module *mod) {
+Module *module_create(const char *source, size_t source_len) {
+    Module *mod = malloc(sizeof(Module));
+    mod->source = source;
+    mod->source_len = source_len;
+    mod->arena = arena_create();
+    mod->names = interner_create();
+    ast_init(&mod->ast);
+    mod->statements = NULL;
+    line_starts_init(&mod->line_starts);
+    mod->line_marks = NULL;
+    mod->locals = scope_create(SCOPE_MODULE, NULL);
+    mod->diagnostics = NULL;
+    mod->bind_diagnostics = NULL;
+    mod->check_diagnostics = NULL;
+    mod->bind_arena = arena_create();
+    mod->check_arena = arena_create();
+    mod->bound = false;
+    mod->refs = NULL;
+    mod->edit_buffer = NULL;
+    mod->edit_capacity = 0;
+    mod->mapping = NULL;
+    mod->mapping_len = 0;
+    return mod;
+}
+
+void module_destroy(Module *mod) {
+    scope_destroy(mod->locals);
+    sb_free(mod->diagnostics);
+    sb_free(mod->bind_diagnostics);
+    sb_free(mod->check_diagnostics);
+    sb_free(mod->line_marks);
+    ref_index_destroy(mod->refs);
+    free(mod->edit_buffer);
+    if (mod->mapping != NULL) {
+        free(mod->names);
+        munmap(mod->mapping, mod->mapping_len);
+    } else {
+        sb_free(mod->statements);
+        sb_free(mod->line_starts);
+        ast_free(&mod->ast);
+        interner_destroy(mod->names);
+    }
+    arena_destroy(mod->arena);
+    arena_destroy(mod->bind_arena);
+    arena_destroy(mod->check_arena);
+    free(mod);
+}
+
+void module_append(Module *mod, Module *other) {
+    int names = interner_count(other->names);
+    int *remap = malloc(sizeof(int) * (names > 0 ? names : 1));
+    for (int id = 0; id < names; id++) {
+        InternedName name = interner_name(other->names, id);
+        Span span = {.offset = 0, .len = name.len};
+        remap[id] = interner_intern(mod->names, name.text, span);
+    }
+
+    NodeId offset = ast_append(&mod->ast, &other->ast, remap);
+    for (int i = 0; i < sb_count(other->statements); i++) {
+        sb_push(mod->statements, other->statements[i] + offset);
+    }
+    for (int i = 0; i < sb_count(other->diagnostics); i++) {
+        sb_push(mod->diagnostics, other->diagnostics[i]);
+    }
+    line_starts_append(&mod->line_starts, other->line_starts);
+    free(remap);
+
+    // Diagnostic messages point into the other arena, so keep it.
+    scope_destroy(other->locals);
+    sb_free(other->statements);
+    sb_free(other->line_starts);
+    ast_free(&other->ast);
+    sb_free(other->diagnostics);
+    interner_destroy(other->names);
+    arena_absorb(mod->arena, other->arena);
+    arena_destroy(other->bind_arena);
+    arena_destroy(other->check_arena);
+    free(other);
+}
+
+LineCol module_line_col(const Module *mod, size_t pos) {
+    return mod->line_marks != NULL ? line_marks_lookup(mod->line_marks, pos) : line_starts_lookup(mod->line_starts, pos);
+}
+
+// The symbol's slot for the first declaration of the same kind as `decl`.
+static NodeId *symbol_first_of_kind(Symbol *symbol, const Ast *ast, NodeId decl) {
+    return ast_kind(ast, decl) == NODE_DECL_LET ? &symbol->value_decl : &symbol->type_decl;
+}
+
+// Recomputes the first declaration of `kind` after one was removed.
+static NodeId symbol_find_first_of_kind(const Symbol *symbol, const Ast *ast, NodeKind kind) {
+    for (int i = 0; i < sb_count(symbol->decls); i++) {
+        if (ast_kind(ast, symbol->decls[i]) == kind) {
+            return symbol->decls[i];
+        }
+    }
+    return AST_NONE;
+}
+
+static void module_report_redeclaration(Module *mod, NodeId decl, NodeId first) {
+    Ast *ast = &mod->ast;
+    InternedName text = interner_name(mod->names, node_name(ast, decl));
+    LineCol at = module_line_col(mod, ast_location(ast, first).pos);
+    diagnostics_add(&mod->bind_diagnostics,
+                    mod->bind_arena,
+                    DIAGNOSTIC_REDECLARATION,
+                    ast_location(ast, decl),
+                    "cannot redeclare %.*s; first declared at %zu:%zu",
+                    (int) text.len,
+                    text.text,
+                    at.line,
+                    at.column);
+}
+
+bool module_bind_stmt(Module *mod, NodeId stmt) {
+    Ast *ast = &mod->ast;
+    if (!ast_is_decl(ast, stmt)) {
+        return false;
+    }
+
+    Symbol *symbol = scope_declare(mod->locals, node_name(ast, stmt));
+    size_t pos = ast_location(ast, stmt).pos;
+    int index = sb_count(symbol->decls);
+    while (index > 0 && ast_location(ast, symbol->decls[index - 1]).pos > pos) {
+        index--;
+    }
+    sb_push(symbol->decls, stmt);
+    memmove(&symbol->decls[index + 1], &symbol->decls[index], (size_t) (sb_count(symbol->decls) - 1 - index) * sizeof(NodeId));
+    symbol->decls[index] = stmt;
+
+    NodeId *first = symbol_first_of_kind(symbol, ast, stmt);
+    bool redeclared = *first != AST_NONE;
+    if (!redeclared || ast_location(ast, *first).pos > pos) {
+        *first = stmt;
+    }
+    return redeclared;
+}
+
+void module_unbind_stmt(Module *mod, NodeId stmt) {
+    Ast *ast = &mod->ast;
+    if (!ast_is_decl(ast, stmt)) {
+        return;
+    }
+
+    int name = node_name(ast, stmt);
+    Symbol *symbol = scope_lookup_local(mod->locals, name);
+    if (symbol == NULL) {
+        return;
+    }
+    for (int i = 0; i < sb_count(symbol->decls); i++) {
+        if (symbol->decls[i] == stmt) {
+            memmove(&symbol->decls[i], &symbol->decls[i + 1], (size_t) (sb_count(symbol->decls) - 1 - i) * sizeof(NodeId));
+            stb__sbn(symbol->decls)--;
+            break;
+        }
+    }
+    if (sb_count(symbol->decls) == 0) {
+        scope_remove(mod->locals, name);
+        return;
+    }
+    NodeId *first = symbol_first_of_kind(symbol, ast, stmt);
+    if (*first == stmt) {
+        *first = symbol_find_first_of_kind(symbol, ast, ast_kind(ast, stmt));
+    }
+}
+
+bool module_bind_first_of_kind(Module *mod, NodeId decl) {
+    Ast *ast = &mod->ast;
+    Symbol *symbol = scope_lookup_local(mod->locals, node_name(ast, decl));
+    if (symbol == NULL) {
+        return true;
+    }
+    NodeId first = *symbol_first_of_kind(symbol, ast, decl);
+    if (first != AST_NONE && first != decl) {
+        module_report_redeclaration(mod, decl, first);
+        return false;
+    }
+    return true;
+}
+
+void module_report_redeclarations(Module *mod) {
+    Ast *ast = &mod->ast;
+    if (mod->bind_diagnostics != NULL) {
+        stb__sbn(mod->bind_diagnostics) = 0;
+    }
+    arena_reset(mod->bind_arena);
     for (int i = 0; i < sb_count(mod->statements); i++) {
-        Stmt stmt = mod->statements[i];
-        if (stmt.type != STMT_DECL) {
+        NodeId decl = mod->statements[i];
+        if (!ast_is_decl(ast, decl)) {
             continue;
         }
+        Symbol *symbol = scope_lookup_local(mod->locals, node_name(ast, decl));
+        NodeId first = *symbol_first_of_kind(symbol, ast, decl);
+        if (first != decl) {
+            module_report_redeclaration(mod, decl, first);
+        }
+    }
+}
 
-        int id = stmt.decl.let.name.id;
-        int n = sb_count(mod->locals);
-        if (id > n) {
-            for (int j = n - 1; j < (2 * n); j++) {
-                LocalsEntry entry = {.set = false};
-                sb_push(mod->locals, entry);
-            }
-        } else if (id == 0 && n == 0) {
-            LocalsEntry entry = {.set = false};
-            sb_push(mod->locals, entry);
+BindResult module_bind(Module *mod) {
+    Ast *ast = &mod->ast;
+    BindResult res = BIND_RESULT_OK;
+    for (int i = 0; i < sb_count(mod->statements); i++) {
+        NodeId decl = mod->statements[i];
+        if (!ast_is_decl(ast, decl)) {
+            continue;
         }
 
-        if (mod->locals[i].set) {
-            LocalsEntry entry = mod->locals[i];
-            for (int j = 0; j < sb_count(entry.local.decls); j++) {
-                Decl other = entry.local.decls[i];
-                if (other.type == stmt.decl.type) {
-                    fprintf(stderr,
-                            "cannot redeclare %s; first declared at %zu\n",
-                            stmt.decl.let.name.text,
-                            other.location.pos);
-                    return BIND_RESULT_CANNOT_REDECLARE;
-                } else {
-                    sb_push(entry.local.decls, stmt.decl);
-                    if (stmt.decl.type == DECL_LET) {
-                        entry.local.has_value_decl = true;
-                        entry.local.value_decl = stmt.decl;
-                    }
-                }
-            }
+        // Statements are in source order, so appending keeps decls sorted.
+        Symbol *symbol = scope_declare(mod->locals, node_name(ast, decl));
+        sb_push(symbol->decls, decl);
+        NodeId *first = symbol_first_of_kind(symbol, ast, decl);
+        if (*first == AST_NONE) {
+            *first = decl;
         } else {
-            Symbol symbol = {.decls = NULL, .has_value_decl = false};
-            Decl *decls = NULL;
-            sb_push(decls, stmt.decl);
-            if (stmt.decl.type == DECL_LET) {
-                symbol.has_value_decl = true;
-                symbol.value_decl = stmt.decl;
-            }
-
-            LocalsEntry entry = {.set = true, .local = symbol};
-            mod->locals[i] = entry;
+            module_report_redeclaration(mod, decl, *first);
+            res = BIND_RESULT_CANNOT_REDECLARE;
         }
     }
 
-    return BIND_RESULT_OK;
+    mod->bound = true;
+    ref_index_destroy(mod->refs);
+    mod->refs = NULL;
+    module_references(mod);
+    return res;
+}
+
+const RefIndex *module_references(Module *mod) {
+    if (mod->refs == NULL) {
+        mod->refs = ref_index_build(&mod->ast, mod->statements, sb_count(mod->statements), interner_count(mod->names));
+    }
+    return mod->refs;
 }
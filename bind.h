@@ -2,27 +2,91 @@
 
 #include <stdbool.h>
 
+#include "arena.h"
 #include "ast.h"
+#include "diag.h"
+#include "intern.h"
+#include "lines.h"
+#include "refs.h"
+#include "scope.h"
 
 typedef struct {
-    bool has_value_decl;
-    Decl value_decl;
-    Decl *decls;
-} Symbol;
+    const char *source;
+    size_t source_len;
+    // The messages of `diagnostics`.
+    Arena *arena;
+    Interner *names;
+    Ast ast;
+    NodeId *statements;
+    // Filled in by the lexer; see lines.h.
+    uint32_t *line_starts;
+    // Set for streamed modules, which keep only the lines that declarations
+    // and diagnostics are on; line_starts is then not a full table.
+    LineMark *line_marks;
+    Scope *locals;
+    // Syntax errors, in source order.
+    Diagnostic *diagnostics;
+    // Redeclarations, in source order; rebuilt by module_bind.
+    Diagnostic *bind_diagnostics;
+    // The messages of bind_diagnostics, reset with the list; edits rebuild
+    // it whenever there are redeclarations.
+    Arena *bind_arena;
+    // Unknown and circular types, in source order; rebuilt by module_check.
+    Diagnostic *check_diagnostics;
+    // The messages of check_diagnostics, reset with the list so a module
+    // that is checked after every edit doesn't keep the old ones.
+    Arena *check_arena;
+    bool bound;
+    // Uses of every name. Built by module_bind, dropped by module_edit and
+    // rebuilt on the next module_references.
+    RefIndex *refs;
+    // A private, editable copy of the source, made by the first
+    // module_edit. `source` points into it from then on.
+    char *edit_buffer;
+    size_t edit_capacity;
+    // Set for modules loaded from the cache: the AST, statements, line
+    // starts and name tables then point into this read-only mapping.
+    void *mapping;
+    size_t mapping_len;
+} Module;
 
-typedef struct {
-    bool set;
-    Symbol local;
-} LocalsEntry;
+Module *module_create(const char *source, size_t source_len);
 
-typedef struct {
-    Stmt *statements;
-    LocalsEntry *locals;
-} Module;
+void module_destroy(Module *mod);
+
+// Moves the statements, names, line starts and diagnostics of `other` onto the end of
+// `mod`, then frees `other`. Neither module may be bound yet.
+void module_append(Module *mod, Module *other);
+
+LineCol module_line_col(const Module *mod, size_t pos);
 
 typedef enum {
     BIND_RESULT_OK,
     BIND_RESULT_CANNOT_REDECLARE,
 } BindResult;
 
+// Declares every top-level statement in `mod->locals`. Each symbol's decls
+// are kept in source order; every declaration after the first of the same
+// kind is reported as a redeclaration. Also builds the reference index.
 BindResult module_bind(Module *mod);
+
+// The reference index of the module, rebuilt first if an edit made it
+// stale.
+const RefIndex *module_references(Module *mod);
+
+// Declares or undeclares a single top-level statement, without reporting
+// redeclarations. Returns true if the symbol now has more than one
+// declaration of the statement's kind.
+bool module_bind_stmt(Module *mod, NodeId stmt);
+
+void module_unbind_stmt(Module *mod, NodeId stmt);
+
+// For streamed modules, whose declarations are released once bound (see
+// stream.h). Returns true if `decl` would be the first declaration of its
+// kind for its symbol, and otherwise reports it as a redeclaration. Doesn't
+// add it to the symbol either way.
+bool module_bind_first_of_kind(Module *mod, NodeId decl);
+
+// Rebuilds bind_diagnostics from the bound symbols, freeing the previous
+// messages.
+void module_report_redeclarations(Module *mod);
@@ -0,0 +1,381 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "vendor/stretchy_buffer.h"
+
+#define CACHE_MAGIC "tscache"
+#define CACHE_BYTE_ORDER 0x01020304u
+
+typedef enum {
+    CACHE_SECTION_KINDS,
+    CACHE_SECTION_LOCATIONS,
+    CACHE_SECTION_DATA,
+    CACHE_SECTION_EXTRA,
+    CACHE_SECTION_NUMBERS,
+    CACHE_SECTION_STATEMENTS,
+    CACHE_SECTION_LINE_STARTS,
+    CACHE_SECTION_NAME_ENTRIES,
+    CACHE_SECTION_NAME_TEXT,
+    CACHE_SECTION_NAME_SLOTS,
+    CACHE_SECTION_COUNT,
+} CacheSection;
+
+static const size_t cache_section_elem_size[CACHE_SECTION_COUNT] = {
+        [CACHE_SECTION_KINDS] = sizeof(uint8_t),
+        [CACHE_SECTION_LOCATIONS] = sizeof(Location),
+        [CACHE_SECTION_DATA] = sizeof(NodeData),
+        [CACHE_SECTION_EXTRA] = sizeof(uint32_t),
+        [CACHE_SECTION_NUMBERS] = sizeof(double),
+        [CACHE_SECTION_STATEMENTS] = sizeof(NodeId),
+        [CACHE_SECTION_LINE_STARTS] = sizeof(uint32_t),
+        [CACHE_SECTION_NAME_ENTRIES] = sizeof(InternEntry),
+        [CACHE_SECTION_NAME_TEXT] = sizeof(char),
+        [CACHE_SECTION_NAME_SLOTS] = sizeof(int),
+};
+
+typedef struct {
+    char magic[8];
+    char version[24];
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint64_t source_hash;
+    uint64_t source_len;
+    uint64_t slot_count;
+    // cache_hash() chained over each array's stretchy buffer header and
+    // elements, in section order.
+    uint64_t payload_hash;
+    // Offset of each array's first element, or 0 for an empty array. The
+    // two ints before it are the stretchy buffer's capacity and count.
+    uint64_t sections[CACHE_SECTION_COUNT];
+} CacheHeader;
+
+#define P1 11400714785074694791ULL
+#define P2 14029467366897019727ULL
+#define P3 1609587929392839161ULL
+#define P4 9650029242287828579ULL
+#define P5 2870177450012600261ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    acc = rotl64(acc, 31);
+    return acc * P1;
+}
+
+static inline uint64_t hash_merge(uint64_t hash, uint64_t acc) {
+    hash ^= hash_round(0, acc);
+    return hash * P1 + P4;
+}
+
+// XXH64: four independent lanes over 32-byte stripes, so it runs at memory
+// speed rather than a byte per cycle like span_hash().
+uint64_t cache_hash(const char *data, size_t len, uint64_t seed) {
+    const char *p = data;
+    const char *end = data + len;
+    uint64_t hash;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + P1 + P2;
+        uint64_t v2 = seed + P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - P1;
+        const char *limit = end - 32;
+        do {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    } else {
+        hash = seed + P5;
+    }
+
+    hash += (uint64_t) len;
+    for (; p + 8 <= end; p += 8) {
+        hash ^= hash_round(0, read64(p));
+        hash = rotl64(hash, 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        hash ^= (uint64_t) read32(p) * P1;
+        hash = rotl64(hash, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= (uint64_t) (unsigned char) *p * P5;
+        hash = rotl64(hash, 11) * P1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= P2;
+    hash ^= hash >> 29;
+    hash *= P3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static uint64_t cache_key(const char *source, size_t source_len) {
+    uint64_t seed = cache_hash(CACHE_VERSION, strlen(CACHE_VERSION), 0);
+    return cache_hash(source, source_len, seed);
+}
+
+static void cache_path(char *path, size_t size, const char *dir, uint64_t key) {
+    snprintf(path, size, "%s/%016llx.tsc", dir, (unsigned long long) key);
+}
+
+static uint64_t cache_section_hash(const char *base, uint64_t offset, size_t elem_size, uint64_t hash) {
+    const char *array = base + offset;
+    int count = ((const int *) array)[-1];
+    hash = cache_hash(array - 2 * sizeof(int), 2 * sizeof(int), hash);
+    return cache_hash(array, (size_t) count * elem_size, hash);
+}
+
+static void *cache_section(char *base, size_t size, uint64_t offset, size_t elem_size, bool *ok) {
+    if (offset == 0) {
+        return NULL;
+    }
+    if (offset % 8 != 0 || offset < sizeof(CacheHeader) + 2 * sizeof(int) || offset > size) {
+        *ok = false;
+        return NULL;
+    }
+    int count = ((int *) (base + offset))[-1];
+    if (count <= 0 || (uint64_t) count > (size - offset) / elem_size) {
+        *ok = false;
+        return NULL;
+    }
+    return base + offset;
+}
+
+Module *cache_load(const char *dir, const char *source, size_t source_len) {
+    uint64_t key = cache_key(source, source_len);
+    char path[4096];
+    cache_path(path, sizeof(path), dir, key);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t) st.st_size;
+    char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    const CacheHeader *header = (const CacheHeader *) base;
+    bool ok = memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+              && strncmp(header->version, CACHE_VERSION, sizeof(header->version)) == 0
+              && header->byte_order == CACHE_BYTE_ORDER
+              && header->header_size == sizeof(CacheHeader)
+              && header->source_hash == key
+              && header->source_len == source_len;
+
+    void *sections[CACHE_SECTION_COUNT] = {NULL};
+    for (int i = 0; ok && i < CACHE_SECTION_COUNT; i++) {
+        sections[i] = cache_section(base, size, header->sections[i], cache_section_elem_size[i], &ok);
+    }
+    ok = ok
+         && sb_count((uint8_t *) sections[CACHE_SECTION_KINDS]) == sb_count((Location *) sections[CACHE_SECTION_LOCATIONS])
+         && sb_count((uint8_t *) sections[CACHE_SECTION_KINDS]) == sb_count((NodeData *) sections[CACHE_SECTION_DATA])
+         && sb_count((uint32_t *) sections[CACHE_SECTION_LINE_STARTS]) > 0
+         && header->slot_count > 0
+         && (header->slot_count & (header->slot_count - 1)) == 0
+         && (uint64_t) sb_count((int *) sections[CACHE_SECTION_NAME_SLOTS]) == header->slot_count;
+    uint64_t payload_hash = 0;
+    for (int i = 0; ok && i < CACHE_SECTION_COUNT; i++) {
+        if (header->sections[i] != 0) {
+            payload_hash = cache_section_hash(base, header->sections[i], cache_section_elem_size[i], payload_hash);
+        }
+    }
+    ok = ok && payload_hash == header->payload_hash;
+    if (!ok) {
+        munmap(base, size);
+        return NULL;
+    }
+
+    Module *mod = module_create(source, source_len);
+    ast_free(&mod->ast);
+    sb_free(mod->line_starts);
+    interner_destroy(mod->names);
+
+    mod->ast.kinds = sections[CACHE_SECTION_KINDS];
+    mod->ast.locations = sections[CACHE_SECTION_LOCATIONS];
+    mod->ast.data = sections[CACHE_SECTION_DATA];
+    mod->ast.extra = sections[CACHE_SECTION_EXTRA];
+    mod->ast.numbers = sections[CACHE_SECTION_NUMBERS];
+    mod->statements = sections[CACHE_SECTION_STATEMENTS];
+    mod->line_starts = sections[CACHE_SECTION_LINE_STARTS];
+    mod->names = malloc(sizeof(Interner));
+    mod->names->entries = sections[CACHE_SECTION_NAME_ENTRIES];
+    mod->names->text = sections[CACHE_SECTION_NAME_TEXT];
+    mod->names->slots = sections[CACHE_SECTION_NAME_SLOTS];
+    mod->names->slot_count = (size_t) header->slot_count;
+    mod->mapping = base;
+    mod->mapping_len = size;
+    return mod;
+}
+
+// Replaces a mapped array with an owned copy.
+#define CACHE_COPY(__array) \
+    do { \
+        __typeof__(__array) __mapped = (__array); \
+        int __count = sb_count(__mapped); \
+        (__array) = NULL; \
+        if (__count > 0) { \
+            memcpy(sb_add(__array, __count), __mapped, (size_t) __count * sizeof(*__mapped)); \
+        } \
+    } while (0)
+
+void cache_detach(Module *mod) {
+    if (mod->mapping == NULL) {
+        return;
+    }
+
+    CACHE_COPY(mod->ast.kinds);
+    CACHE_COPY(mod->ast.locations);
+    CACHE_COPY(mod->ast.data);
+    CACHE_COPY(mod->ast.extra);
+    CACHE_COPY(mod->ast.numbers);
+    CACHE_COPY(mod->statements);
+    CACHE_COPY(mod->line_starts);
+    CACHE_COPY(mod->names->entries);
+    CACHE_COPY(mod->names->text);
+    // The slot table is a plain array.
+    int *slots = malloc(sizeof(int) * mod->names->slot_count);
+    memcpy(slots, mod->names->slots, sizeof(int) * mod->names->slot_count);
+    mod->names->slots = slots;
+
+    munmap(mod->mapping, mod->mapping_len);
+    mod->mapping = NULL;
+    mod->mapping_len = 0;
+}
+
+typedef struct {
+    FILE *out;
+    uint64_t offset;
+    uint64_t payload_hash;
+    bool ok;
+} CacheWriter;
+
+static void cache_write(CacheWriter *writer, const void *data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, writer->out) != len) {
+        writer->ok = false;
+    }
+    writer->offset += len;
+}
+
+static uint64_t cache_write_array(CacheWriter *writer, const void *data, int count, size_t elem_size) {
+    if (count == 0) {
+        return 0;
+    }
+    static const char zeros[8] = {0};
+    cache_write(writer, zeros, (8 - writer->offset % 8) % 8);
+
+    // Same header as a stretchy buffer: capacity, then count.
+    int header[2] = {count, count};
+    cache_write(writer, header, sizeof(header));
+    uint64_t offset = writer->offset;
+    cache_write(writer, data, (size_t) count * elem_size);
+    writer->payload_hash = cache_hash((const char *) header, sizeof(header), writer->payload_hash);
+    writer->payload_hash = cache_hash(data, (size_t) count * elem_size, writer->payload_hash);
+    return offset;
+}
+
+bool cache_store(const char *dir, const Module *mod) {
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    uint64_t key = cache_key(mod->source, mod->source_len);
+    char path[4096];
+    cache_path(path, sizeof(path), dir, key);
+    // Write to a temporary name and rename, so concurrent runs never see a
+    // partial file.
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/.%016llx.XXXXXX", dir, (unsigned long long) key);
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        return false;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    strncpy(header.version, CACHE_VERSION, sizeof(header.version) - 1);
+    header.byte_order = CACHE_BYTE_ORDER;
+    header.header_size = sizeof(CacheHeader);
+    header.source_hash = key;
+    header.source_len = mod->source_len;
+    header.slot_count = mod->names->slot_count;
+
+    CacheWriter writer = {.out = fdopen(fd, "wb"), .offset = 0, .payload_hash = 0, .ok = true};
+    if (writer.out == NULL) {
+        close(fd);
+        unlink(tmp_path);
+        return false;
+    }
+    cache_write(&writer, &header, sizeof(header));
+
+    const Ast *ast = &mod->ast;
+    const Interner *names = mod->names;
+    uint64_t *sections = header.sections;
+    sections[CACHE_SECTION_KINDS] = cache_write_array(&writer, ast->kinds, sb_count(ast->kinds), sizeof(uint8_t));
+    sections[CACHE_SECTION_LOCATIONS] = cache_write_array(&writer, ast->locations, sb_count(ast->locations), sizeof(Location));
+    sections[CACHE_SECTION_DATA] = cache_write_array(&writer, ast->data, sb_count(ast->data), sizeof(NodeData));
+    sections[CACHE_SECTION_EXTRA] = cache_write_array(&writer, ast->extra, sb_count(ast->extra), sizeof(uint32_t));
+    sections[CACHE_SECTION_NUMBERS] = cache_write_array(&writer, ast->numbers, sb_count(ast->numbers), sizeof(double));
+    sections[CACHE_SECTION_STATEMENTS] = cache_write_array(&writer, mod->statements, sb_count(mod->statements), sizeof(NodeId));
+    sections[CACHE_SECTION_LINE_STARTS] = cache_write_array(&writer, mod->line_starts, sb_count(mod->line_starts), sizeof(uint32_t));
+    sections[CACHE_SECTION_NAME_ENTRIES] = cache_write_array(&writer, names->entries, sb_count(names->entries), sizeof(InternEntry));
+    sections[CACHE_SECTION_NAME_TEXT] = cache_write_array(&writer, names->text, sb_count(names->text), sizeof(char));
+    sections[CACHE_SECTION_NAME_SLOTS] = cache_write_array(&writer, names->slots, (int) names->slot_count, sizeof(int));
+
+    // Rewrite the header now that the offsets and hash are known.
+    header.payload_hash = writer.payload_hash;
+    if (fseek(writer.out, 0, SEEK_SET) != 0) {
+        writer.ok = false;
+    }
+    cache_write(&writer, &header, sizeof(header));
+    if (fclose(writer.out) != 0) {
+        writer.ok = false;
+    }
+
+    if (!writer.ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bind.h"
+
+// Bump whenever parser output or the file layout changes; it is mixed into
+// every cache key.
+#define CACHE_VERSION "ts-cache-2"
+
+// Parsed modules are cached in `dir` under a 64-bit hash of the source
+// bytes and CACHE_VERSION. A cache file holds the AST arrays, statements,
+// line starts and name tables, each laid out as a stretchy buffer (header
+// included) at an 8-byte aligned offset, so a loaded module's buffers point
+// straight into the read-only mapping. Files use native byte order.
+//
+// The header also holds a hash of the arrays. A file whose arrays don't
+// match it is rejected, since a corrupted node index or name id would
+// otherwise send the binder and checker out of bounds.
+
+uint64_t cache_hash(const char *data, size_t len, uint64_t seed);
+
+// Returns NULL on a miss or an unusable cache file. The module has not been
+// bound, and must be detached before it is edited or appended to.
+Module *cache_load(const char *dir, const char *source, size_t source_len);
+
+// Copies a cached module's arrays into ordinary buffers and releases the
+// mapping, so the module can be edited.
+void cache_detach(Module *mod);
+
+// Writes an unbound, freshly parsed module. Only modules that parsed
+// without diagnostics should be stored.
+bool cache_store(const char *dir, const Module *mod);
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "vendor/stretchy_buffer.h"
+
+typedef enum {
+    CHECK_UNVISITED,
+    // On the chain currently being walked; meeting one again is a cycle.
+    CHECK_ACTIVE,
+    CHECK_RESOLVED,
+} CheckState;
+
+static const char *const builtin_names[TYPE_BUILTIN_COUNT] = {"number", "string", "boolean"};
+
+const char *type_name(Type type) {
+    return type == TYPE_ERROR ? "<error>" : builtin_names[type - 1];
+}
+
+Checker *checker_create(Module *mod) {
+    Checker *checker = malloc(sizeof(Checker));
+    int names = interner_count(mod->names);
+    checker->mod = mod;
+    checker->states = calloc(names > 0 ? names : 1, 1);
+    checker->types = calloc(names > 0 ? names : 1, 1);
+    for (int i = 0; i < TYPE_BUILTIN_COUNT; i++) {
+        int name = interner_lookup(mod->names, builtin_names[i], strlen(builtin_names[i]));
+        checker->builtins[i] = name;
+        if (name >= 0) {
+            checker->states[name] = CHECK_RESOLVED;
+            checker->types[name] = (uint8_t) (TYPE_NUMBER + i);
+        }
+    }
+    checker->chain = NULL;
+    return checker;
+}
+
+void checker_destroy(Checker *checker) {
+    free(checker->states);
+    free(checker->types);
+    sb_free(checker->chain);
+    free(checker);
+}
+
+static NodeId checker_alias_decl(Checker *checker, int name) {
+    Symbol *symbol = scope_lookup(checker->mod->locals, name);
+    if (symbol == NULL) {
+        return AST_NONE;
+    }
+    return symbol->type_decl;
+}
+
+static void checker_report(Checker *checker, NodeId node, const char *fmt, int name) {
+    Module *mod = checker->mod;
+    InternedName text = interner_name(mod->names, name);
+    diagnostics_add(&mod->check_diagnostics, mod->check_arena, DIAGNOSTIC_TYPE, ast_location(&mod->ast, node), fmt, (int) text.len, text.text);
+}
+
+Type checker_resolve(Checker *checker, int name, NodeId user) {
+    Ast *ast = &checker->mod->ast;
+    if (checker->chain != NULL) {
+        stb__sbn(checker->chain) = 0;
+    }
+
+    // Follow the chain iteratively, so long chains can't overflow the
+    // stack, until it reaches a resolved name, an unknown name or itself.
+    Type type;
+    while (true) {
+        if (checker->states[name] == CHECK_RESOLVED) {
+            type = (Type) checker->types[name];
+            break;
+        }
+        if (checker->states[name] == CHECK_ACTIVE) {
+            int i = sb_count(checker->chain);
+            do {
+                i--;
+                checker_report(checker, checker_alias_decl(checker, checker->chain[i]),
+                               "type alias %.*s circularly references itself", checker->chain[i]);
+            } while (checker->chain[i] != name);
+            type = TYPE_ERROR;
+            break;
+        }
+        NodeId decl = checker_alias_decl(checker, name);
+        if (decl == AST_NONE) {
+            // Unknown names are left unresolved so every use is reported.
+            checker_report(checker, user, "cannot find type %.*s", name);
+            type = TYPE_ERROR;
+            break;
+        }
+        checker->states[name] = CHECK_ACTIVE;
+        sb_push(checker->chain, name);
+        user = decl;
+        name = decl_type_alias_type_name(ast, decl);
+    }
+
+    for (int i = 0; i < sb_count(checker->chain); i++) {
+        checker->states[checker->chain[i]] = CHECK_RESOLVED;
+        checker->types[checker->chain[i]] = (uint8_t) type;
+    }
+    return type;
+}
+
+static int compare_diagnostics(const void *a, const void *b) {
+    size_t pa = ((const Diagnostic *) a)->location.pos;
+    size_t pb = ((const Diagnostic *) b)->location.pos;
+    return pa < pb ? -1 : pa > pb;
+}
+
+void module_check(Module *mod) {
+    if (mod->check_diagnostics != NULL) {
+        stb__sbn(mod->check_diagnostics) = 0;
+    }
+    arena_reset(mod->check_arena);
+
+    Ast *ast = &mod->ast;
+    Checker *checker = checker_create(mod);
+    for (int i = 0; i < sb_count(mod->statements); i++) {
+        NodeId stmt = mod->statements[i];
+        int name = -1;
+        if (ast_kind(ast, stmt) == NODE_DECL_LET) {
+            name = decl_let_type_name(ast, stmt);
+        } else if (ast_kind(ast, stmt) == NODE_DECL_TYPE_ALIAS && checker_alias_decl(checker, node_name(ast, stmt)) == stmt) {
+            // Resolving the alias itself, rather than its target, reports
+            // a cycle that nothing else refers to. Redeclarations were
+            // already reported by the binder.
+            name = node_name(ast, stmt);
+        }
+        if (name >= 0) {
+            checker_resolve(checker, name, stmt);
+        }
+    }
+    checker_destroy(checker);
+
+    // Cycles are reported all at once, out of source order.
+    if (sb_count(mod->check_diagnostics) > 1) {
+        qsort(mod->check_diagnostics, sb_count(mod->check_diagnostics), sizeof(Diagnostic), compare_diagnostics);
+    }
+}
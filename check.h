@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "bind.h"
+
+// Every alias chain ends in a builtin, so a resolved type is one of these.
+typedef enum {
+    // An unknown name or a circular alias; already reported.
+    TYPE_ERROR,
+    TYPE_NUMBER,
+    TYPE_STRING,
+    TYPE_BOOLEAN,
+} Type;
+
+#define TYPE_BUILTIN_COUNT 3
+
+const char *type_name(Type type);
+
+// Resolves type names through `type A = B;` aliases in a bound module.
+// Results are memoized per name id, and every alias on a walked chain is
+// pointed straight at the result, so each alias is followed once no matter
+// how long the chain or how many names lead into it.
+typedef struct {
+    Module *mod;
+    // Per name id: CheckState and, once resolved, the Type.
+    uint8_t *states;
+    uint8_t *types;
+    // Name ids of the builtin type names, or -1 if they never appear.
+    int builtins[TYPE_BUILTIN_COUNT];
+    // Scratch stack of the aliases on the chain being walked.
+    int *chain;
+} Checker;
+
+Checker *checker_create(Module *mod);
+
+void checker_destroy(Checker *checker);
+
+// Resolves a type name used by `user`, a let or type alias declaration.
+// An unknown name is reported against `user`, and a cycle against every
+// alias on it.
+Type checker_resolve(Checker *checker, int name, NodeId user);
+
+// Rebuilds mod->check_diagnostics by resolving every type alias and let
+// annotation, freeing the previous messages. The module must be bound.
+void module_check(Module *mod);
@@ -0,0 +1,59 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "diag.h"
+#include "vendor/stretchy_buffer.h"
+
+char *diagnostic_kind_name(DiagnosticKind kind) {
+    switch (kind) {
+        case DIAGNOSTIC_SYNTAX:
+            return "DIAGNOSTIC_SYNTAX";
+        case DIAGNOSTIC_REDECLARATION:
+            return "DIAGNOSTIC_REDECLARATION";
+        case DIAGNOSTIC_TYPE:
+            return "DIAGNOSTIC_TYPE";
+        default:
+            return "(unknown)";
+    }
+}
+
+void diagnostics_add(Diagnostic **diagnostics,
+                     Arena *arena,
+                     DiagnosticKind kind,
+                     Location location,
+                     const char *fmt,
+                     ...) {
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    char *message = arena_alloc(arena, (size_t) len + 1);
+    va_start(args, fmt);
+    vsnprintf(message, (size_t) len + 1, fmt, args);
+    va_end(args);
+
+    Diagnostic diagnostic = {.kind = kind, .location = location, .message = message};
+    sb_push(*diagnostics, diagnostic);
+}
+
+void diagnostics_print(FILE *out,
+                       const char *path,
+                       const char *source,
+                       size_t source_len,
+                       const uint32_t *line_starts,
+                       const LineMark *line_marks,
+                       Diagnostic *diagnostics) {
+    for (int i = 0; i < sb_count(diagnostics); i++) {
+        size_t pos = diagnostics[i].location.pos;
+        LineCol at = line_marks != NULL ? line_marks_lookup(line_marks, pos) : line_starts_lookup(line_starts, pos);
+        size_t line_start = pos - (at.column - 1);
+        const char *newline = memchr(source + line_start, '\n', source_len - line_start);
+        size_t line_end = newline != NULL ? (size_t) (newline - source) : source_len;
+
+        fprintf(out, "%s:%zu:%zu: %s\n", path, at.line, at.column, diagnostics[i].message);
+        fprintf(out, "%.*s\n", (int) (line_end - line_start), source + line_start);
+        fprintf(out, "%*s^\n", (int) (at.column - 1), "");
+    }
+}
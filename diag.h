@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "lines.h"
+
+typedef enum {
+    DIAGNOSTIC_SYNTAX,
+    DIAGNOSTIC_REDECLARATION,
+    DIAGNOSTIC_TYPE,
+} DiagnosticKind;
+
+char *diagnostic_kind_name(DiagnosticKind kind);
+
+typedef struct {
+    DiagnosticKind kind;
+    Location location;
+    char *message;
+} Diagnostic;
+
+// Appends a diagnostic to the stretchy buffer `*diagnostics`, formatting the
+// message into `arena`.
+void diagnostics_add(Diagnostic **diagnostics,
+                     Arena *arena,
+                     DiagnosticKind kind,
+                     Location location,
+                     const char *fmt,
+                     ...) __attribute__((format(printf, 5, 6)));
+
+// Prints each diagnostic as `path:line:column: message` followed by the
+// source line and a caret under the column. Lines are looked up in
+// `line_marks` when it is set, and in `line_starts` otherwise.
+void diagnostics_print(FILE *out,
+                       const char *path,
+                       const char *source,
+                       size_t source_len,
+                       const uint32_t *line_starts,
+                       const LineMark *line_marks,
+                       Diagnostic *diagnostics);
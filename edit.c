@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "edit.h"
+#include "lexer.h"
+#include "vendor/stretchy_buffer.h"
+
+static size_t stmt_pos(const Module *mod, int i) {
+    return ast_location(&mod->ast, mod->statements[i]).pos;
+}
+
+// Returns the index of the first statement that starts at or after `pos`.
+static int module_stmt_index(const Module *mod, size_t pos) {
+    int lo = 0;
+    int hi = sb_count(mod->statements);
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (stmt_pos(mod, mid) < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void module_splice_source(Module *mod, size_t offset, size_t removed, const char *inserted, size_t inserted_len) {
+    size_t tail = mod->source_len - offset - removed;
+    size_t len = mod->source_len - removed + inserted_len;
+    if (mod->edit_buffer == NULL || len > mod->edit_capacity) {
+        size_t capacity = len + len / 2 + 64;
+        char *buffer = malloc(capacity);
+        memcpy(buffer, mod->source, offset);
+        memcpy(buffer + offset + inserted_len, mod->source + offset + removed, tail);
+        free(mod->edit_buffer);
+        mod->edit_buffer = buffer;
+        mod->edit_capacity = capacity;
+    } else {
+        memmove(mod->edit_buffer + offset + inserted_len, mod->edit_buffer + offset + removed, tail);
+    }
+    memcpy(mod->edit_buffer + offset, inserted, inserted_len);
+    mod->source = mod->edit_buffer;
+    mod->source_len = len;
+}
+
+typedef struct {
+    NodeId *statements;
+    Diagnostic *diagnostics;
+    uint32_t *line_starts;
+    // Index into the stop list where parsing ended.
+    int stop_index;
+    ParseResult res;
+} Reparse;
+
+static Reparse module_reparse(Module *mod, size_t start, const size_t *stops) {
+    // The parser appends to the module's lists; hand it empty ones so the
+    // new statements, diagnostics and line starts come back separately.
+    NodeId *statements = mod->statements;
+    Diagnostic *diagnostics = mod->diagnostics;
+    uint32_t *line_starts = mod->line_starts;
+    mod->statements = NULL;
+    mod->diagnostics = NULL;
+    mod->line_starts = NULL;
+
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    lexer->pos = start;
+    Parser *parser = parser_create(lexer);
+    parser->stops = stops;
+    parser->stop_count = sb_count(stops);
+    Reparse reparse;
+    reparse.res = parser_parse(parser, mod);
+    reparse.stop_index = parser->stop_index;
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+
+    reparse.statements = mod->statements;
+    reparse.diagnostics = mod->diagnostics;
+    reparse.line_starts = mod->line_starts;
+    mod->statements = statements;
+    mod->diagnostics = diagnostics;
+    mod->line_starts = line_starts;
+    return reparse;
+}
+
+// Parses and, if the module was bound, binds the whole source again,
+// dropping every node, message and symbol of the old parse.
+static ParseResult module_reparse_all(Module *mod) {
+    ast_free(&mod->ast);
+    sb_free(mod->statements);
+    mod->statements = NULL;
+    sb_free(mod->diagnostics);
+    mod->diagnostics = NULL;
+    arena_reset(mod->arena);
+    sb_free(mod->line_starts);
+    line_starts_init(&mod->line_starts);
+
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    ParseResult res = parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+
+    if (mod->bound) {
+        scope_destroy(mod->locals);
+        mod->locals = scope_create(SCOPE_MODULE, NULL);
+        if (mod->bind_diagnostics != NULL) {
+            stb__sbn(mod->bind_diagnostics) = 0;
+        }
+        arena_reset(mod->bind_arena);
+        module_bind(mod);
+    }
+    return res;
+}
+
+ParseResult module_edit(Module *mod, size_t offset, size_t removed, const char *inserted, size_t inserted_len) {
+    cache_detach(mod);
+
+    int count = sb_count(mod->statements);
+    int nodes = ast_node_count(&mod->ast);
+    size_t old_len = mod->source_len;
+    module_splice_source(mod, offset, removed, inserted, inserted_len);
+    // Errors past the cap weren't kept, so the old list can't tell which
+    // one an edit that fixes an earlier error would bring into view.
+    if (sb_count(mod->diagnostics) > PARSER_MAX_ERRORS) {
+        return module_reparse_all(mod);
+    }
+    size_t delta_add = inserted_len;
+    size_t delta_sub = removed;
+
+    // Between statements the parser's only state is its position, so a
+    // reparse can start wherever the old parse started a statement, as long
+    // as nothing the old parse looked at before that point changed. Error
+    // recovery looks at the first token after a failed statement, so start
+    // a full statement before the one the edit lands in.
+    int first = module_stmt_index(mod, offset + 1) - 2;
+    if (first < 0) {
+        first = 0;
+    }
+    size_t start = first == 0 ? 0 : stmt_pos(mod, first);
+
+    // Likewise the reparse can stop once it is between statements at the
+    // start of an old statement past the edit: from there on it would
+    // repeat the old parse.
+    int after = module_stmt_index(mod, offset + removed);
+    size_t *stops = NULL;
+    for (int i = after; i < count; i++) {
+        sb_push(stops, stmt_pos(mod, i) + delta_add - delta_sub);
+    }
+
+    Reparse reparse = module_reparse(mod, start, stops);
+
+    // Statements [first, last) were replaced; old_end and new_end are where
+    // the untouched tail starts before and after the edit.
+    int last = after + reparse.stop_index;
+    size_t old_end = last < count ? stmt_pos(mod, last) : old_len;
+    size_t new_end = last < count ? stops[reparse.stop_index] : mod->source_len;
+    sb_free(stops);
+
+    if (mod->bound) {
+        for (int i = first; i < last; i++) {
+            module_unbind_stmt(mod, mod->statements[i]);
+        }
+    }
+
+    // Shift the tail. Nodes of replaced statements are unreachable, so they
+    // don't need to be excluded.
+    if (last < count) {
+        for (int i = 0; i < nodes; i++) {
+            size_t pos = mod->ast.locations[i].pos;
+            if (pos >= old_end) {
+                mod->ast.locations[i].pos = pos + delta_add - delta_sub;
+            }
+        }
+    }
+
+    NodeId *statements = NULL;
+    for (int i = 0; i < first; i++) {
+        sb_push(statements, mod->statements[i]);
+    }
+    for (int i = 0; i < sb_count(reparse.statements); i++) {
+        sb_push(statements, reparse.statements[i]);
+    }
+    for (int i = last; i < count; i++) {
+        sb_push(statements, mod->statements[i]);
+    }
+    sb_free(mod->statements);
+    mod->statements = statements;
+
+    // Error recovery can stop on the first token of the next statement, so
+    // an error at the start of a statement belongs to the one before it.
+    Diagnostic *diagnostics = NULL;
+    for (int i = 0; i < sb_count(mod->diagnostics); i++) {
+        Diagnostic diagnostic = mod->diagnostics[i];
+        if (diagnostic.location.pos < start || (first > 0 && diagnostic.location.pos == start)) {
+            sb_push(diagnostics, diagnostic);
+        }
+    }
+    for (int i = 0; i < sb_count(reparse.diagnostics); i++) {
+        sb_push(diagnostics, reparse.diagnostics[i]);
+    }
+    for (int i = 0; i < sb_count(mod->diagnostics); i++) {
+        Diagnostic diagnostic = mod->diagnostics[i];
+        if (last < count && diagnostic.location.pos > old_end) {
+            diagnostic.location.pos += delta_add - delta_sub;
+            sb_push(diagnostics, diagnostic);
+        }
+    }
+    sb_free(mod->diagnostics);
+    mod->diagnostics = diagnostics;
+
+    // The reparse lexer may have scanned past new_end, so the tail's line
+    // starts come from the old table.
+    uint32_t *line_starts = NULL;
+    for (int i = 0; i < sb_count(mod->line_starts) && mod->line_starts[i] <= start; i++) {
+        sb_push(line_starts, mod->line_starts[i]);
+    }
+    for (int i = 0; i < sb_count(reparse.line_starts); i++) {
+        uint32_t line_start = reparse.line_starts[i];
+        if (line_start > start && (line_start <= new_end || last == count)) {
+            sb_push(line_starts, line_start);
+        }
+    }
+    for (int i = 0; i < sb_count(mod->line_starts) && last < count; i++) {
+        if (mod->line_starts[i] > old_end) {
+            sb_push(line_starts, (uint32_t) (mod->line_starts[i] + delta_add - delta_sub));
+        }
+    }
+    sb_free(mod->line_starts);
+    mod->line_starts = line_starts;
+
+    // Every use after the edit moved, so the index is rebuilt when it's
+    // next asked for rather than patched here.
+    ref_index_destroy(mod->refs);
+    mod->refs = NULL;
+
+    if (mod->bound) {
+        bool redeclared = false;
+        for (int i = 0; i < sb_count(reparse.statements); i++) {
+            redeclared |= module_bind_stmt(mod, reparse.statements[i]);
+        }
+        // Redeclaration messages mention line numbers, so any existing ones
+        // are rebuilt too.
+        if (redeclared || sb_count(mod->bind_diagnostics) > 0) {
+            module_report_redeclarations(mod);
+        }
+    }
+
+    sb_free(reparse.statements);
+    sb_free(reparse.diagnostics);
+    sb_free(reparse.line_starts);
+
+    // The reparse counted its errors from zero, so past the cap the merged
+    // list holds errors that a full parse would have left out.
+    if (sb_count(mod->diagnostics) > PARSER_MAX_ERRORS) {
+        return module_reparse_all(mod);
+    }
+    return reparse.res;
+}
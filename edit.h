@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "bind.h"
+#include "parser.h"
+
+// Replaces `removed` bytes at `offset` with `inserted` and brings the module
+// up to date by reparsing only the top-level statements the edit touches.
+// Later statements, line starts and diagnostics are shifted in place, and if
+// the module is bound its symbols are updated for the statements that were
+// replaced. Returns the result of reparsing the touched statements.
+//
+// Replaced statements leave their nodes behind in the AST; they are
+// unreachable and only freed with the module.
+//
+// A module with more than PARSER_MAX_ERRORS syntax errors before or after
+// the edit is reparsed in full instead, since the errors past the cap were
+// never recorded. That also frees the old nodes, and the result is that of
+// the whole parse.
+ParseResult module_edit(Module *mod, size_t offset, size_t removed, const char *inserted, size_t inserted_len);
@@ -0,0 +1,99 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "emit.h"
+#include "scan.h"
+#include "vendor/stretchy_buffer.h"
+
+#define EMITTER_BUFFER_SIZE (1024 * 1024)
+
+void emitter_init(Emitter *emitter, int fd) {
+    emitter->fd = fd;
+    emitter->buf = malloc(EMITTER_BUFFER_SIZE);
+    emitter->len = 0;
+    emitter->capacity = EMITTER_BUFFER_SIZE;
+    emitter->error = 0;
+}
+
+static void emitter_write_all(Emitter *emitter, const char *data, size_t len) {
+    while (len > 0 && emitter->error == 0) {
+        ssize_t n = write(emitter->fd, data, len);
+        if (n < 0) {
+            if (errno != EINTR) {
+                emitter->error = errno;
+            }
+            continue;
+        }
+        data += n;
+        len -= (size_t) n;
+    }
+}
+
+static void emitter_flush(Emitter *emitter) {
+    emitter_write_all(emitter, emitter->buf, emitter->len);
+    emitter->len = 0;
+}
+
+void emitter_write(Emitter *emitter, const char *data, size_t len) {
+    if (emitter->len + len > emitter->capacity) {
+        emitter_flush(emitter);
+    }
+    if (len >= emitter->capacity) {
+        emitter_write_all(emitter, data, len);
+        return;
+    }
+    memcpy(emitter->buf + emitter->len, data, len);
+    emitter->len += len;
+}
+
+bool emitter_finish(Emitter *emitter) {
+    emitter_flush(emitter);
+    free(emitter->buf);
+    emitter->buf = NULL;
+    if (emitter->error != 0) {
+        errno = emitter->error;
+        return false;
+    }
+    return true;
+}
+
+// There are no strings or comments yet, so a statement's text ends at the
+// first ';' after its start, and a let's annotation starts at the first
+// ':' after it.
+static size_t find_char(const Module *mod, size_t pos, char c) {
+    const char *found = memchr(mod->source + pos, c, mod->source_len - pos);
+    return found != NULL ? (size_t) (found - mod->source) : mod->source_len;
+}
+
+void module_emit_js(const Module *mod, Emitter *emitter) {
+    const Ast *ast = &mod->ast;
+    const char *source = mod->source;
+    // Everything before `copied` has been written or cut.
+    size_t copied = 0;
+    for (int i = 0; i < sb_count(mod->statements); i++) {
+        NodeId stmt = mod->statements[i];
+        size_t pos = ast_location(ast, stmt).pos;
+        size_t cut_start;
+        size_t cut_end;
+        if (ast_kind(ast, stmt) == NODE_DECL_TYPE_ALIAS) {
+            cut_start = pos;
+            cut_end = find_char(mod, pos, ';') + 1;
+        } else if (ast_kind(ast, stmt) == NODE_DECL_LET && decl_let_type_name(ast, stmt) >= 0) {
+            cut_start = find_char(mod, pos, ':');
+            cut_end = cut_start + 1;
+            while (cut_end < mod->source_len && char_is(source[cut_end], CHAR_SPACE)) {
+                cut_end++;
+            }
+            while (cut_end < mod->source_len && char_is(source[cut_end], CHAR_IDENT)) {
+                cut_end++;
+            }
+        } else {
+            continue;
+        }
+        emitter_write(emitter, source + copied, cut_start - copied);
+        copied = cut_end;
+    }
+    emitter_write(emitter, source + copied, mod->source_len - copied);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bind.h"
+
+// Buffers output for a file descriptor and writes it out in large chunks.
+// Spans at least as large as the buffer are written straight from where
+// they are, without being copied.
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t capacity;
+    // The errno of the first failed write, after which output is dropped.
+    int error;
+} Emitter;
+
+void emitter_init(Emitter *emitter, int fd);
+
+void emitter_write(Emitter *emitter, const char *data, size_t len);
+
+// Writes out anything buffered and frees the buffer. Returns false, with
+// errno set, if any write failed.
+bool emitter_finish(Emitter *emitter);
+
+// Writes the module as JavaScript: the source with type aliases and let
+// annotations cut out, and everything else copied through unchanged, so
+// line numbers stay the same. The module must have parsed without errors;
+// it doesn't need to be bound.
+void module_emit_js(const Module *mod, Emitter *emitter);
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+#include "vendor/stretchy_buffer.h"
+
+#define INTERNER_INITIAL_SLOTS 64
+#define INTERNER_EMPTY (-1)
+
+Interner *interner_create(void) {
+    Interner *interner = malloc(sizeof(Interner));
+    interner->entries = NULL;
+    interner->text = NULL;
+    interner->slot_count = INTERNER_INITIAL_SLOTS;
+    interner->slots = malloc(sizeof(int) * interner->slot_count);
+    memset(interner->slots, 0xff, sizeof(int) * interner->slot_count);
+    return interner;
+}
+
+void interner_destroy(Interner *interner) {
+    sb_free(interner->entries);
+    sb_free(interner->text);
+    free(interner->slots);
+    free(interner);
+}
+
+static void interner_grow(Interner *interner) {
+    size_t slot_count = interner->slot_count * 2;
+    int *slots = malloc(sizeof(int) * slot_count);
+    memset(slots, 0xff, sizeof(int) * slot_count);
+
+    size_t mask = slot_count - 1;
+    for (int id = 0; id < sb_count(interner->entries); id++) {
+        size_t i = interner->entries[id].hash & mask;
+        while (slots[i] != INTERNER_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+
+    free(interner->slots);
+    interner->slots = slots;
+    interner->slot_count = slot_count;
+}
+
+// Returns the slot holding `text`, or the empty slot where it belongs.
+static size_t interner_find_slot(Interner *interner, const char *text, size_t len, uint64_t hash) {
+    size_t mask = interner->slot_count - 1;
+    size_t i = hash & mask;
+    while (true) {
+        int id = interner->slots[i];
+        if (id == INTERNER_EMPTY) {
+            return i;
+        }
+        InternEntry *entry = &interner->entries[id];
+        if (entry->hash == hash && entry->len == len && memcmp(interner->text + entry->offset, text, len) == 0) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+int interner_intern(Interner *interner, const char *source, Span span) {
+    const char *text = span_text(source, span);
+    uint64_t hash = span_hash(source, span);
+    size_t slot = interner_find_slot(interner, text, span.len, hash);
+    if (interner->slots[slot] != INTERNER_EMPTY) {
+        return interner->slots[slot];
+    }
+
+    int id = sb_count(interner->entries);
+    InternEntry entry = {
+            .offset = (uint32_t) sb_count(interner->text),
+            .len = (uint32_t) span.len,
+            .hash = hash,
+    };
+    char *copy = sb_add(interner->text, (int) span.len + 1);
+    memcpy(copy, text, span.len);
+    copy[span.len] = '\0';
+    sb_push(interner->entries, entry);
+    interner->slots[slot] = id;
+
+    // Keep the load factor at or below 1/2.
+    if ((size_t) sb_count(interner->entries) * 2 > interner->slot_count) {
+        interner_grow(interner);
+    }
+    return id;
+}
+
+int interner_lookup(Interner *interner, const char *text, size_t len) {
+    Span span = {.offset = 0, .len = len};
+    size_t slot = interner_find_slot(interner, text, len, span_hash(text, span));
+    return interner->slots[slot];
+}
+
+int interner_count(Interner *interner) {
+    return sb_count(interner->entries);
+}
+
+InternedName interner_name(Interner *interner, int id) {
+    InternEntry entry = interner->entries[id];
+    InternedName name = {.text = interner->text + entry.offset, .len = entry.len, .hash = entry.hash};
+    return name;
+}
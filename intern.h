@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "span.h"
+
+typedef struct {
+    const char *text;
+    size_t len;
+    uint64_t hash;
+} InternedName;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+    uint64_t hash;
+} InternEntry;
+
+// Maps each distinct identifier to a dense id, in order of first appearance.
+// Name text is copied once per distinct name into one buffer and referred to
+// by offset, so the tables hold no pointers and can be written out and
+// mapped back in as they are (see cache.h).
+typedef struct {
+    InternEntry *entries;
+    // NUL-terminated names, back to back.
+    char *text;
+    int *slots;
+    size_t slot_count;
+} Interner;
+
+Interner *interner_create(void);
+
+void interner_destroy(Interner *interner);
+
+int interner_intern(Interner *interner, const char *source, Span span);
+
+int interner_lookup(Interner *interner, const char *text, size_t len);
+
+int interner_count(Interner *interner);
+
+// The text pointer is only valid until the next name is interned.
+InternedName interner_name(Interner *interner, int id);
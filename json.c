@@ -0,0 +1,362 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "vendor/stretchy_buffer.h"
+
+// Bounds recursion on hostile input.
+#define JSON_MAX_DEPTH 256
+
+typedef struct {
+    Arena *arena;
+    const char *text;
+    size_t len;
+    size_t pos;
+    int depth;
+} JsonParser;
+
+static void json_skip_whitespace(JsonParser *p) {
+    while (p->pos < p->len) {
+        char c = p->text[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return;
+        }
+        p->pos++;
+    }
+}
+
+static bool json_try_char(JsonParser *p, char c) {
+    json_skip_whitespace(p);
+    if (p->pos < p->len && p->text[p->pos] == c) {
+        p->pos++;
+        return true;
+    }
+    return false;
+}
+
+static bool json_try_literal(JsonParser *p, const char *literal) {
+    size_t len = strlen(literal);
+    if (p->len - p->pos >= len && memcmp(p->text + p->pos, literal, len) == 0) {
+        p->pos += len;
+        return true;
+    }
+    return false;
+}
+
+static int json_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool json_parse_hex4(JsonParser *p, uint32_t *out) {
+    if (p->len - p->pos < 4) {
+        return false;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = json_hex_digit(p->text[p->pos++]);
+        if (digit < 0) {
+            return false;
+        }
+        value = value << 4 | (uint32_t) digit;
+    }
+    *out = value;
+    return true;
+}
+
+static void json_push_utf8(char **buf, uint32_t cp) {
+    if (cp < 0x80) {
+        sb_push(*buf, (char) cp);
+    } else if (cp < 0x800) {
+        sb_push(*buf, (char) (0xc0 | cp >> 6));
+        sb_push(*buf, (char) (0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        sb_push(*buf, (char) (0xe0 | cp >> 12));
+        sb_push(*buf, (char) (0x80 | (cp >> 6 & 0x3f)));
+        sb_push(*buf, (char) (0x80 | (cp & 0x3f)));
+    } else {
+        sb_push(*buf, (char) (0xf0 | cp >> 18));
+        sb_push(*buf, (char) (0x80 | (cp >> 12 & 0x3f)));
+        sb_push(*buf, (char) (0x80 | (cp >> 6 & 0x3f)));
+        sb_push(*buf, (char) (0x80 | (cp & 0x3f)));
+    }
+}
+
+static bool json_unescape(JsonParser *p, char **buf) {
+    if (p->pos >= p->len) {
+        return false;
+    }
+    char c = p->text[p->pos++];
+    switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            sb_push(*buf, c);
+            return true;
+        case 'b':
+            sb_push(*buf, '\b');
+            return true;
+        case 'f':
+            sb_push(*buf, '\f');
+            return true;
+        case 'n':
+            sb_push(*buf, '\n');
+            return true;
+        case 'r':
+            sb_push(*buf, '\r');
+            return true;
+        case 't':
+            sb_push(*buf, '\t');
+            return true;
+        case 'u': {
+            uint32_t cp;
+            if (!json_parse_hex4(p, &cp)) {
+                return false;
+            }
+            // Join surrogate pairs; lone surrogates become U+FFFD.
+            if (cp >= 0xd800 && cp < 0xdc00) {
+                uint32_t low;
+                size_t save = p->pos;
+                if (json_try_literal(p, "\\u") && json_parse_hex4(p, &low) && low >= 0xdc00 && low < 0xe000) {
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                } else {
+                    p->pos = save;
+                    cp = 0xfffd;
+                }
+            } else if (cp >= 0xdc00 && cp < 0xe000) {
+                cp = 0xfffd;
+            }
+            json_push_utf8(buf, cp);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool json_parse_string(JsonParser *p, char **text, size_t *len) {
+    if (!json_try_char(p, '"')) {
+        return false;
+    }
+    // Copy straight from the input up to the first escape.
+    size_t start = p->pos;
+    while (p->pos < p->len && p->text[p->pos] != '"' && p->text[p->pos] != '\\') {
+        if ((unsigned char) p->text[p->pos] < 0x20) {
+            return false;
+        }
+        p->pos++;
+    }
+    if (p->pos >= p->len) {
+        return false;
+    }
+    if (p->text[p->pos] == '"') {
+        *len = p->pos - start;
+        *text = arena_strndup(p->arena, p->text + start, *len);
+        p->pos++;
+        return true;
+    }
+
+    char *buf = NULL;
+    for (size_t i = start; i < p->pos; i++) {
+        sb_push(buf, p->text[i]);
+    }
+    bool ok = false;
+    while (p->pos < p->len) {
+        char c = p->text[p->pos++];
+        if (c == '"') {
+            ok = true;
+            break;
+        }
+        if ((unsigned char) c < 0x20) {
+            break;
+        }
+        if (c != '\\') {
+            sb_push(buf, c);
+        } else if (!json_unescape(p, &buf)) {
+            break;
+        }
+    }
+    if (ok) {
+        *len = sb_count(buf);
+        *text = arena_strndup(p->arena, buf, *len);
+    }
+    sb_free(buf);
+    return ok;
+}
+
+static bool json_parse_number(JsonParser *p, double *number) {
+    size_t start = p->pos;
+    if (p->pos < p->len && p->text[p->pos] == '-') {
+        p->pos++;
+    }
+    size_t digits = p->pos;
+    while (p->pos < p->len && strchr("0123456789.eE+-", p->text[p->pos]) != NULL) {
+        p->pos++;
+    }
+    if (p->pos == digits) {
+        return false;
+    }
+    // strtod wants a terminated string; numbers are short.
+    char buf[64];
+    size_t len = p->pos - start;
+    if (len >= sizeof(buf)) {
+        return false;
+    }
+    memcpy(buf, p->text + start, len);
+    buf[len] = '\0';
+    char *end;
+    *number = strtod(buf, &end);
+    return end == buf + len;
+}
+
+static bool json_parse_value(JsonParser *p, JsonValue *value);
+
+static bool json_parse_array(JsonParser *p, JsonValue *value) {
+    JsonValue *items = NULL;
+    bool ok = json_try_char(p, ']');
+    while (!ok) {
+        JsonValue item;
+        if (!json_parse_value(p, &item)) {
+            break;
+        }
+        sb_push(items, item);
+        if (json_try_char(p, ']')) {
+            ok = true;
+        } else if (!json_try_char(p, ',')) {
+            break;
+        }
+    }
+    value->kind = JSON_ARRAY;
+    value->array.count = sb_count(items);
+    value->array.items = arena_alloc(p->arena, sizeof(JsonValue) * value->array.count);
+    if (value->array.count > 0) {
+        memcpy(value->array.items, items, sizeof(JsonValue) * value->array.count);
+    }
+    sb_free(items);
+    return ok;
+}
+
+static bool json_parse_object(JsonParser *p, JsonValue *value) {
+    JsonMember *members = NULL;
+    bool ok = json_try_char(p, '}');
+    while (!ok) {
+        JsonMember member;
+        size_t key_len;
+        if (!json_parse_string(p, &member.key, &key_len) || !json_try_char(p, ':')
+            || !json_parse_value(p, &member.value)) {
+            break;
+        }
+        sb_push(members, member);
+        if (json_try_char(p, '}')) {
+            ok = true;
+        } else if (!json_try_char(p, ',')) {
+            break;
+        }
+    }
+    value->kind = JSON_OBJECT;
+    value->object.count = sb_count(members);
+    value->object.members = arena_alloc(p->arena, sizeof(JsonMember) * value->object.count);
+    if (value->object.count > 0) {
+        memcpy(value->object.members, members, sizeof(JsonMember) * value->object.count);
+    }
+    sb_free(members);
+    return ok;
+}
+
+static bool json_parse_value(JsonParser *p, JsonValue *value) {
+    json_skip_whitespace(p);
+    if (p->pos >= p->len) {
+        return false;
+    }
+    switch (p->text[p->pos]) {
+        case '{':
+        case '[': {
+            if (++p->depth > JSON_MAX_DEPTH) {
+                return false;
+            }
+            bool ok = p->text[p->pos++] == '{' ? json_parse_object(p, value) : json_parse_array(p, value);
+            p->depth--;
+            return ok;
+        }
+        case '"':
+            value->kind = JSON_STRING;
+            return json_parse_string(p, &value->string.text, &value->string.len);
+        case 't':
+            value->kind = JSON_BOOL;
+            value->boolean = true;
+            return json_try_literal(p, "true");
+        case 'f':
+            value->kind = JSON_BOOL;
+            value->boolean = false;
+            return json_try_literal(p, "false");
+        case 'n':
+            value->kind = JSON_NULL;
+            return json_try_literal(p, "null");
+        default:
+            value->kind = JSON_NUMBER;
+            return json_parse_number(p, &value->number);
+    }
+}
+
+JsonValue *json_parse(Arena *arena, const char *text, size_t len) {
+    JsonParser p = {.arena = arena, .text = text, .len = len, .pos = 0, .depth = 0};
+    JsonValue *value = arena_alloc(arena, sizeof(JsonValue));
+    if (!json_parse_value(&p, value)) {
+        return NULL;
+    }
+    json_skip_whitespace(&p);
+    return p.pos == len ? value : NULL;
+}
+
+const JsonValue *json_get(const JsonValue *object, const char *key) {
+    if (object == NULL || object->kind != JSON_OBJECT) {
+        return NULL;
+    }
+    for (size_t i = 0; i < object->object.count; i++) {
+        if (strcmp(object->object.members[i].key, key) == 0) {
+            return &object->object.members[i].value;
+        }
+    }
+    return NULL;
+}
+
+const char *json_get_string(const JsonValue *value, size_t *len) {
+    if (value == NULL || value->kind != JSON_STRING) {
+        return NULL;
+    }
+    *len = value->string.len;
+    return value->string.text;
+}
+
+bool json_get_number(const JsonValue *value, double *number) {
+    if (value == NULL || value->kind != JSON_NUMBER) {
+        return false;
+    }
+    *number = value->number;
+    return true;
+}
+
+void json_write_string(FILE *out, const char *str, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        char c = str[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if ((unsigned char) c < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char) c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
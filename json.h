@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "arena.h"
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT,
+} JsonKind;
+
+typedef struct JsonValue_ JsonValue;
+typedef struct JsonMember_ JsonMember;
+
+struct JsonValue_ {
+    JsonKind kind;
+    union {
+        bool boolean;
+        double number;
+        // Unescaped and NUL-terminated; may contain NULs.
+        struct {
+            char *text;
+            size_t len;
+        } string;
+        struct {
+            JsonValue *items;
+            size_t count;
+        } array;
+        struct {
+            JsonMember *members;
+            size_t count;
+        } object;
+    };
+};
+
+struct JsonMember_ {
+    char *key;
+    JsonValue value;
+};
+
+// Parses one JSON document, allocating the tree from `arena`. Returns NULL
+// if the text is not valid JSON or nests too deeply.
+JsonValue *json_parse(Arena *arena, const char *text, size_t len);
+
+// Returns the member `key` of an object, or NULL if `object` is NULL, not an
+// object or has no such member.
+const JsonValue *json_get(const JsonValue *object, const char *key);
+
+// Return NULL / false if `value` is NULL or of another kind.
+const char *json_get_string(const JsonValue *value, size_t *len);
+
+bool json_get_number(const JsonValue *value, double *number);
+
+void json_write_string(FILE *out, const char *str, size_t len);
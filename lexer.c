@@ -2,12 +2,15 @@
 // Created by Christian Scott on 9/8/21.
 //
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <ctype.h>
 
 #include "lexer.h"
+#include "number.h"
+#include "scan.h"
+#include "vendor/stretchy_buffer.h"
 
 char *token_type_name(TokenType type) {
     switch (type) {
@@ -33,28 +36,35 @@ char *token_type_name(TokenType type) {
             return "TOK_END_OF_FILE";
         case TOK_UNKNOWN:
             return "TOK_UNKNOWN";
+        case TOK_INVALID_NUMBER:
+            return "TOK_INVALID_NUMBER";
         default:
             return "(unknown token type)";
     }
 }
 
-Token *token_create(TokenType type, char *text) {
-    Token *token = malloc(sizeof(Token));
-    token->type = type;
-    token->text = text;
-    return token;
-}
-
-Lexer *lexer_create(char *source) {
+Lexer *lexer_create(const char *source, size_t source_len, Arena *arena, Interner *interner) {
     Lexer *lexer = malloc(sizeof(Lexer));
-    lexer->token = NULL;
-    lexer->prev_token = NULL;
+    lexer->arena = arena;
+    lexer->interner = interner;
+    lexer->kernels = scan_kernels_best();
     lexer->pos = 0;
     lexer->source = source;
-    lexer->source_len = strlen(source);
+    lexer->source_len = source_len;
+    lexer->line_starts = NULL;
+    lexer->stats = NULL;
+    lexer->trace = NULL;
+    lexer->trace_batch_start = 0;
+    lexer->trace_batch_ns = 0;
+    lexer->trace_batch_tokens = 0;
     return lexer;
 }
 
+void lexer_destroy(Lexer *lexer) {
+    sb_free(lexer->line_starts);
+    free(lexer);
+}
+
 bool lexer_has_more_chars(Lexer *lexer) {
     return lexer->pos < lexer->source_len;
 }
@@ -63,100 +73,168 @@ char lexer_char(Lexer *lexer) {
     return lexer->source[lexer->pos];
 }
 
-char *substr(char *orig, size_t from, size_t to) {
-    size_t len = to - from;
-    char *sub = malloc(sizeof(char) * (len + 1));
-    strncpy(sub, orig + from, len);
-    sub[len] = '\0';
-    return sub;
-}
-
-bool is_digit(char c) {
-    return '0' <= c && c <= '9';
-}
-
-bool is_alpha(char c) {
-    return ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z');
-}
-
-bool is_alphanumeric(char c) {
-    return is_alpha(c) || is_digit(c);
-}
-
-bool is_identifier_char(char c) {
-    return is_alphanumeric(c) || c == '_';
-}
-
-void lexer_set_token(Lexer *lexer, Token *token) {
-    if (lexer->prev_token != NULL) {
-        free(lexer->prev_token);
+// Keywords are matched on length and first character, so adding one costs
+// a case label rather than another comparison on every identifier.
+static TokenType keyword_type(const char *text, size_t len) {
+    switch (len) {
+        case 3:
+            if (text[0] == 'l' && memcmp(text, "let", 3) == 0) {
+                return TOK_LET;
+            }
+            break;
+        case 4:
+            if (text[0] == 't' && memcmp(text, "type", 4) == 0) {
+                return TOK_TYPE;
+            }
+            break;
+        case 6:
+            if (text[0] == 'r' && memcmp(text, "return", 6) == 0) {
+                return TOK_RETURN;
+            }
+            break;
+        case 8:
+            if (text[0] == 'f' && memcmp(text, "function", 8) == 0) {
+                return TOK_FUNCTION;
+            }
+            break;
+        default:
+            break;
     }
-    lexer->prev_token = lexer->token;
-    lexer->token = token;
+    return TOK_IDENT;
 }
 
-void lexer_scan(Lexer *lexer) {
-    if (lexer->token != NULL && lexer->token->type == TOK_END_OF_FILE) {
-        return;
-    }
+static inline void lexer_set_token(Lexer *lexer, Token *token, TokenType type, size_t start) {
+    token->type = type;
+    token->offset = (uint32_t) start;
+    token->len = (uint32_t) (lexer->pos - start);
+    token->id = type == TOK_IDENT ? interner_intern(lexer->interner, lexer->source, token_span(token)) : -1;
+}
 
-    while (lexer_has_more_chars(lexer) && isspace(lexer_char(lexer))) {
-        lexer->pos++;
+static inline void lexer_scan_token(Lexer *lexer, Token *token) {
+    size_t space_start = lexer->pos;
+    lexer->pos = lexer->kernels->skip_whitespace(lexer->source, lexer->pos, lexer->source_len);
+    // Newlines are whitespace, so every line break is in a skipped run.
+    if (lexer->pos - space_start == 1) {
+        if (lexer->source[space_start] == '\n') {
+            sb_push(lexer->line_starts, (uint32_t) lexer->pos);
+        }
+    } else if (lexer->pos != space_start) {
+        line_starts_scan(&lexer->line_starts, lexer->source, space_start, lexer->pos);
     }
 
     size_t start = lexer->pos;
     if (!lexer_has_more_chars(lexer)) {
-        lexer_set_token(lexer, token_create(TOK_END_OF_FILE, "EOF"));
+        lexer_set_token(lexer, token, TOK_END_OF_FILE, start);
         return;
     }
 
-    if (is_digit(lexer_char(lexer))) {
-        while (lexer_has_more_chars(lexer) && is_digit(lexer_char(lexer))) {
-            lexer->pos++;
+    if (char_is(lexer_char(lexer), CHAR_DIGIT)
+        || (lexer_char(lexer) == '.' && start + 1 < lexer->source_len && char_is(lexer->source[start + 1], CHAR_DIGIT))) {
+        double value;
+        if (number_scan(lexer->source, lexer->source_len, lexer->kernels->skip_digits, &lexer->pos, &value)) {
+            token->type = TOK_NUMBER;
+            token->offset = (uint32_t) start;
+            token->number = value;
+        } else {
+            lexer_set_token(lexer, token, TOK_INVALID_NUMBER, start);
         }
-
-        char *text = substr(lexer->source, start, lexer->pos);
-        lexer_set_token(lexer, token_create(TOK_NUMBER, text));
         return;
     }
 
-    if (is_alpha(lexer_char(lexer))) {
-        while (lexer_has_more_chars(lexer) && is_identifier_char(lexer_char(lexer))) {
-            lexer->pos++;
-        }
+    if (char_is(lexer_char(lexer), CHAR_IDENT_START)) {
+        lexer->pos = lexer->kernels->skip_identifier(lexer->source, lexer->pos, lexer->source_len);
 
-        char *text = substr(lexer->source, start, lexer->pos);
-        TokenType type;
-        if (strcmp(text, "function") == 0) {
-            type = TOK_FUNCTION;
-        } else if (strcmp(text, "let") == 0) {
-            type = TOK_LET;
-        } else if (strcmp(text, "type") == 0) {
-            type = TOK_TYPE;
-        } else if (strcmp(text, "return") == 0) {
-            type = TOK_RETURN;
-        } else {
-            type = TOK_IDENT;
-        }
-        lexer_set_token(lexer, token_create(type, text));
+        TokenType type = keyword_type(lexer->source + start, lexer->pos - start);
+        lexer_set_token(lexer, token, type, start);
         return;
     }
 
     lexer->pos++;
     switch (lexer->source[lexer->pos - 1]) {
         case '=':
-            lexer->token = token_create(TOK_EQ, "=");
+            lexer_set_token(lexer, token, TOK_EQ, start);
             break;
         case ';':
-            lexer->token = token_create(TOK_SEMICOLON, ";");
+            lexer_set_token(lexer, token, TOK_SEMICOLON, start);
             break;
         case ':':
-            lexer->token = token_create(TOK_COLON, ":");
+            lexer_set_token(lexer, token, TOK_COLON, start);
             break;
-        default: {
-            char *text = substr(lexer->source, start, lexer->pos);
-            lexer->token = token_create(TOK_UNKNOWN, text);
+        default:
+            lexer_set_token(lexer, token, TOK_UNKNOWN, start);
             break;
+    }
+}
+
+void lexer_scan(Lexer *lexer, Token *token) {
+    lexer_scan_token(lexer, token);
+}
+
+static size_t lexer_scan_batch_plain(Lexer *lexer, Token *out, size_t max) {
+    for (size_t i = 0; i < max; i++) {
+        lexer_scan_token(lexer, &out[i]);
+        if (out[i].type == TOK_END_OF_FILE) {
+            return i + 1;
+        }
+    }
+    return max;
+}
+
+#define LEXER_TRACE_BATCH 4096
+
+void lexer_flush_trace(Lexer *lexer) {
+    if (lexer->trace == NULL || lexer->trace_batch_tokens == 0) {
+        return;
+    }
+    char detail[32];
+    snprintf(detail, sizeof(detail), "%d tokens", lexer->trace_batch_tokens);
+    trace_span(lexer->trace,
+               TRACE_TRACK_LEXER,
+               "lexer_scan",
+               lexer->trace_batch_start,
+               lexer->trace_batch_start + lexer->trace_batch_ns,
+               detail);
+    lexer->trace_batch_tokens = 0;
+    lexer->trace_batch_ns = 0;
+}
+
+__attribute__((noinline)) static size_t lexer_scan_batch_instrumented(Lexer *lexer, Token *out, size_t max) {
+    uint64_t start = trace_now_ns();
+    size_t count = lexer_scan_batch_plain(lexer, out, max);
+    uint64_t elapsed = trace_now_ns() - start;
+
+    if (lexer->stats != NULL) {
+        lexer->stats->lex_ns += elapsed;
+        lexer->stats->tokens += count;
+    }
+    if (lexer->trace != NULL) {
+        if (lexer->trace_batch_tokens == 0) {
+            lexer->trace_batch_start = start;
+        }
+        lexer->trace_batch_ns += elapsed;
+        lexer->trace_batch_tokens += (int) count;
+        if (lexer->trace_batch_tokens >= LEXER_TRACE_BATCH) {
+            lexer_flush_trace(lexer);
+        }
+    }
+    return count;
+}
+
+size_t lexer_scan_batch(Lexer *lexer, Token *out, size_t max) {
+    if (__builtin_expect(lexer->stats != NULL || lexer->trace != NULL, 0)) {
+        return lexer_scan_batch_instrumented(lexer, out, max);
+    }
+    return lexer_scan_batch_plain(lexer, out, max);
+}
+
+Token *lexer_tokenize(Lexer *lexer) {
+    Token *tokens = NULL;
+    Token batch[1024];
+    while (true) {
+        size_t count = lexer_scan_batch(lexer, batch, sizeof(batch) / sizeof(batch[0]));
+        memcpy(sb_add(tokens, (int) count), batch, count * sizeof(Token));
+        if (batch[count - 1].type == TOK_END_OF_FILE) {
+            return tokens;
         }
     }
 }
@@ -1,6 +1,14 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "intern.h"
+#include "lines.h"
+#include "scan.h"
+#include "span.h"
+#include "trace.h"
 
 typedef enum {
     TOK_FUNCTION,
@@ -14,27 +22,72 @@ typedef enum {
     TOK_COLON,
     TOK_END_OF_FILE,
     TOK_UNKNOWN,
+    TOK_INVALID_NUMBER,
 } TokenType;
 
+// Tokens are packed to 16 bytes so whole-file token arrays stay small;
+// offsets are 32-bit, which limits sources to LEXER_MAX_SOURCE_LEN.
 typedef struct {
-    TokenType type;
-    char *text;
+    uint32_t offset;
+    uint8_t type;
+    union {
+        // Every token but TOK_NUMBER.
+        struct {
+            uint32_t len;
+            // Interned name id for TOK_IDENT, -1 otherwise.
+            int32_t id;
+        };
+        // TOK_NUMBER carries its value instead.
+        double number;
+    };
 } Token;
 
+#define LEXER_MAX_SOURCE_LEN ((size_t) UINT32_MAX)
+
+// Not for TOK_NUMBER, which has no length.
+static inline Span token_span(const Token *token) {
+    return span_create(token->offset, token->offset + token->len);
+}
+
 typedef struct {
-    Token *prev_token;
-    Token *token;
+    Arena *arena;
+    Interner *interner;
+    const ScanKernels *kernels;
     size_t pos;
-    char *source;
+    const char *source;
     size_t source_len;
+    // Start offsets of the lines that begin in the text scanned so far
+    // (see lines.h). The first line is the module's, not the lexer's.
+    uint32_t *line_starts;
+
+    // Optional instrumentation; lexer_scan_batch only reads the clock when
+    // one of these is set.
+    Stats *stats;
+    Trace *trace;
+    uint64_t trace_batch_start;
+    uint64_t trace_batch_ns;
+    int trace_batch_tokens;
 } Lexer;
 
 char *token_type_name(TokenType type);
 
-Lexer *lexer_create(char *source);
+Lexer *lexer_create(const char *source, size_t source_len, Arena *arena, Interner *interner);
+
+void lexer_destroy(Lexer *lexer);
 
 bool lexer_has_more_chars(Lexer *lexer);
 
-char *substr(char *orig, size_t from, size_t to);
+// Scans the next token. At the end of the source this keeps returning
+// TOK_END_OF_FILE.
+void lexer_scan(Lexer *lexer, Token *token);
+
+// Scans up to `max` tokens into `out` and returns how many were written.
+// Stops early after writing TOK_END_OF_FILE.
+size_t lexer_scan_batch(Lexer *lexer, Token *out, size_t max);
+
+// Scans the rest of the source into a stretchy buffer ending with
+// TOK_END_OF_FILE.
+Token *lexer_tokenize(Lexer *lexer);
 
-void lexer_scan(Lexer *lexer);
+// Emits any partially filled trace batch.
+void lexer_flush_trace(Lexer *lexer);
@@ -0,0 +1,60 @@
+#include <string.h>
+
+#include "lines.h"
+#include "vendor/stretchy_buffer.h"
+
+void line_starts_init(uint32_t **line_starts) {
+    *line_starts = NULL;
+    sb_push(*line_starts, 0);
+}
+
+void line_starts_scan(uint32_t **line_starts, const char *source, size_t from, size_t to) {
+    const char *cursor = source + from;
+    const char *end = source + to;
+    while ((cursor = memchr(cursor, '\n', (size_t) (end - cursor))) != NULL) {
+        cursor++;
+        sb_push(*line_starts, (uint32_t) (cursor - source));
+    }
+}
+
+void line_starts_append(uint32_t **dst, const uint32_t *src) {
+    int first = 0;
+    while (first < sb_count(src) && sb_count(*dst) > 0 && src[first] <= sb_last(*dst)) {
+        first++;
+    }
+    int count = sb_count(src) - first;
+    if (count > 0) {
+        memcpy(sb_add(*dst, count), src + first, (size_t) count * sizeof(uint32_t));
+    }
+}
+
+LineCol line_starts_lookup(const uint32_t *line_starts, size_t pos) {
+    // Find the last line starting at or before pos.
+    size_t lo = 0;
+    size_t hi = (size_t) sb_count(line_starts);
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (line_starts[mid] <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    LineCol result = {.line = lo + 1, .column = pos - line_starts[lo] + 1};
+    return result;
+}
+
+LineCol line_marks_lookup(const LineMark *line_marks, size_t pos) {
+    size_t lo = 0;
+    size_t hi = (size_t) sb_count(line_marks);
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (line_marks[mid].start <= pos) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    LineCol result = {.line = line_marks[lo].line, .column = pos - line_marks[lo].start + 1};
+    return result;
+}
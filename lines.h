@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 1-based line and byte column.
+typedef struct {
+    size_t line;
+    size_t column;
+} LineCol;
+
+// Line tables are stretchy buffers of the offsets at which each line
+// begins, in increasing order and starting with 0. The lexer fills them in
+// as it skips whitespace.
+void line_starts_init(uint32_t **line_starts);
+
+// Appends the start of every line that begins in source[from, to).
+void line_starts_scan(uint32_t **line_starts, const char *source, size_t from, size_t to);
+
+// Appends the entries of `src` that come after the last line start in
+// `*dst`, so tables for consecutive pieces of a source can be joined.
+void line_starts_append(uint32_t **dst, const uint32_t *src);
+
+LineCol line_starts_lookup(const uint32_t *line_starts, size_t pos);
+
+// A sparse line table, for modules that can't keep a start for every line:
+// the starts of some lines with their 1-based numbers, in increasing order.
+typedef struct {
+    uint32_t start;
+    uint32_t line;
+} LineMark;
+
+// Only correct for positions on a marked line.
+LineCol line_marks_lookup(const LineMark *line_marks, size_t pos);
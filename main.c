@@ -1,39 +1,366 @@
-#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "lexer.h"
 #include "bind.h"
+#include "cache.h"
+#include "check.h"
+#include "emit.h"
 #include "parser.h"
+#include "pool.h"
+#include "serve.h"
+#include "source.h"
+#include "stream.h"
+#include "tokens.h"
+#include "trace.h"
+#include "vendor/stretchy_buffer.h"
 
-int main(int argc, char **argv) {
-    char *source;
-    if (argc > 1) {
-        source = argv[1];
+// Files at least this large are also split and parsed in parallel.
+#define PARALLEL_PARSE_MIN_BYTES (8 * 1024 * 1024)
+
+typedef struct {
+    Pool *pool;
+    int threads;
+    TokenMode token_mode;
+    // Parsed modules are cached here when set.
+    const char *cache_dir;
+    bool stats;
+    Trace *trace;
+    // Write JavaScript instead of binding and checking.
+    bool emit_js;
+    // Bind each statement as it's parsed and then release it.
+    bool stream;
+    // Uses of this name are listed when set.
+    const char *references;
+} Options;
+
+typedef struct {
+    const Options *options;
+    const char *path;
+    int open_errno;
+    ParseResult parse_res;
+    bool ok;
+    Stats stats;
+    // Diagnostics are rendered on the worker and printed in input order.
+    char *diagnostics;
+    size_t diagnostics_len;
+    // `path:line:column` of each use of the --references name.
+    char *references;
+    size_t references_len;
+    // Where --emit-js wrote, and why that failed.
+    char *emit_path;
+    int emit_errno;
+} FileJob;
+
+static Module *parse_source(FileJob *job, const char *source, size_t source_len, Stats *stats) {
+    const Options *options = job->options;
+    Module *mod = module_create(source, source_len);
+    bool chunked = options->pool != NULL && options->threads > 1 && source_len >= PARALLEL_PARSE_MIN_BYTES;
+    if (chunked) {
+        job->parse_res = parser_parse_chunked(mod, options->pool, options->threads * 2, stats, options->trace);
     } else {
-        source = "let a = 1;\n"
-                 "let b: number = 2;\n"
-                 "let c = a = b;";
+        Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+        Parser *parser = parser_create(lexer);
+        parser->token_mode = options->token_mode;
+        parser->stats = stats;
+        parser->trace = options->trace;
+        job->parse_res = parser_parse(parser, mod);
+        parser_destroy(parser);
+        lexer_destroy(lexer);
+    }
+    return mod;
+}
+
+static void write_references(FileJob *job, Module *mod, const char *name) {
+    FILE *out = open_memstream(&job->references, &job->references_len);
+    RefCursor cursor = ref_index_find(module_references(mod), interner_lookup(mod->names, name, strlen(name)));
+    size_t pos;
+    while (ref_cursor_next(&cursor, &pos)) {
+        LineCol at = line_starts_lookup(mod->line_starts, pos);
+        fprintf(out, "%s:%zu:%zu\n", job->path, at.line, at.column);
     }
+    fclose(out);
+}
 
-    Parser *parser = parser_create(lexer_create(source));
+// Writes the JavaScript for `path` next to it, as path.js with any .ts
+// extension replaced, or to stdout for the builtin source.
+static bool emit_js(FileJob *job, const Module *mod) {
+    int fd = STDOUT_FILENO;
+    if (strcmp(job->path, "<builtin>") != 0) {
+        size_t len = strlen(job->path);
+        if (len >= 3 && strcmp(job->path + len - 3, ".ts") == 0) {
+            len -= 3;
+        }
+        job->emit_path = malloc(len + 4);
+        memcpy(job->emit_path, job->path, len);
+        memcpy(job->emit_path + len, ".js", 4);
+        fd = open(job->emit_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            job->emit_errno = errno;
+            return false;
+        }
+    }
 
-    Stmt *statements = NULL;
-    Module *mod = malloc(sizeof(Module));
-    mod->statements = statements;
-    mod->locals = NULL;
+    Emitter emitter;
+    emitter_init(&emitter, fd);
+    module_emit_js(mod, &emitter);
+    bool ok = emitter_finish(&emitter);
+    if (!ok) {
+        job->emit_errno = errno;
+    }
+    if (fd != STDOUT_FILENO && close(fd) != 0 && ok) {
+        job->emit_errno = errno;
+        ok = false;
+    }
+    return ok;
+}
 
-    ParseResult res = parser_parse(parser, mod);
-    if (res != PARSE_RESULT_OK) {
-        printf("failed to parse: %s\n", parse_result_name(res));
-        return 1;
+// `file` is NULL for the builtin source.
+static bool check_source(FileJob *job, const SourceFile *file, const char *source, size_t source_len) {
+    const Options *options = job->options;
+    Stats *stats = options->stats ? &job->stats : NULL;
+    bool timed = options->stats || options->trace != NULL;
+
+    uint64_t parse_start = timed ? trace_now_ns() : 0;
+    Module *mod = NULL;
+    // A streamed module is bound as it's parsed, and isn't worth caching.
+    bool cacheable = options->cache_dir != NULL && !options->stream;
+    if (cacheable) {
+        mod = cache_load(options->cache_dir, source, source_len);
+    }
+    bool cached = mod != NULL;
+    BindResult bind_res = BIND_RESULT_OK;
+    size_t statements = 0;
+    if (cached) {
+        job->parse_res = PARSE_RESULT_OK;
+    } else if (options->stream) {
+        mod = module_create(source, source_len);
+        StreamResult streamed = module_parse_streaming(mod, file, stats, options->trace);
+        job->parse_res = streamed.parse_res;
+        bind_res = streamed.bind_res;
+        statements = streamed.statements;
+    } else {
+        mod = parse_source(job, source, source_len, stats);
+    }
+    if (!options->stream) {
+        statements = (size_t) sb_count(mod->statements);
+    }
+    uint64_t parse_end = timed ? trace_now_ns() : 0;
+    if (options->trace != NULL) {
+        const char *span = cached ? "cache_load" : options->stream ? "module_parse_streaming" : "parser_parse";
+        trace_span(options->trace, TRACE_TRACK_MAIN, span, parse_start, parse_end, job->path);
+    }
+
+    if (!cached && cacheable && job->parse_res == PARSE_RESULT_OK && sb_count(mod->diagnostics) == 0) {
+        // A failed store only costs the next run a parse.
+        cache_store(options->cache_dir, mod);
+        uint64_t store_end = timed ? trace_now_ns() : 0;
+        if (options->trace != NULL) {
+            trace_span(options->trace, TRACE_TRACK_MAIN, "cache_store", parse_end, store_end, job->path);
+        }
+        parse_end = store_end;
+    }
+
+    bool emitted = true;
+    uint64_t bind_end = parse_end;
+    uint64_t check_end = parse_end;
+    uint64_t emit_end = parse_end;
+    if (options->emit_js) {
+        // Stripping types needs no symbols, so binding and checking are
+        // skipped.
+        emitted = job->parse_res == PARSE_RESULT_OK && sb_count(mod->diagnostics) == 0 && emit_js(job, mod);
+        emit_end = timed ? trace_now_ns() : 0;
+        if (options->trace != NULL) {
+            trace_span(options->trace, TRACE_TRACK_MAIN, "module_emit_js", parse_end, emit_end, job->path);
+        }
+    } else {
+        // Statements that failed to parse were left out, so the rest can
+        // still be bound and checked, and their errors reported in the
+        // same run.
+        if (!options->stream) {
+            bind_res = module_bind(mod);
+        }
+        bind_end = timed ? trace_now_ns() : 0;
+        if (options->trace != NULL) {
+            trace_span(options->trace, TRACE_TRACK_MAIN, "module_bind", parse_end, bind_end, job->path);
+        }
+
+        module_check(mod);
+        check_end = timed ? trace_now_ns() : 0;
+        if (options->trace != NULL) {
+            trace_span(options->trace, TRACE_TRACK_MAIN, "module_check", bind_end, check_end, job->path);
+        }
+        emit_end = check_end;
+    }
+
+    if (options->references != NULL && mod->bound) {
+        write_references(job, mod, options->references);
+    }
+
+    if (stats != NULL) {
+        stats->files = 1;
+        stats->bytes = source_len;
+        stats->cache_hits = cached ? 1 : 0;
+        stats->bind_ns = bind_end - parse_end;
+        stats->check_ns = check_end - bind_end;
+        stats->emit_ns = emit_end - check_end;
+        stats->statements = statements;
+        stats->symbols = scope_symbol_count(mod->locals);
+        stats->allocations = mod->arena->allocations;
+        stats->arena_bytes = mod->arena->chunk_bytes;
     }
 
-    BindResult bind_res = module_bind(mod);
-    if (bind_res != BIND_RESULT_OK) {
+    FILE *out = open_memstream(&job->diagnostics, &job->diagnostics_len);
+    diagnostics_print(out, job->path, mod->source, mod->source_len, mod->line_starts, mod->line_marks, mod->diagnostics);
+    diagnostics_print(out, job->path, mod->source, mod->source_len, mod->line_starts, mod->line_marks, mod->bind_diagnostics);
+    diagnostics_print(out, job->path, mod->source, mod->source_len, mod->line_starts, mod->line_marks, mod->check_diagnostics);
+    fclose(out);
+
+    bool checked = sb_count(mod->check_diagnostics) == 0;
+    module_destroy(mod);
+    return job->parse_res == PARSE_RESULT_OK && bind_res == BIND_RESULT_OK && checked && emitted;
+}
+
+static void check_file(void *arg) {
+    FileJob *job = arg;
+    SourceFile file;
+    if (!source_file_open(&file, job->path)) {
+        job->open_errno = errno;
+        job->ok = false;
+        return;
+    }
+    if (file.len > LEXER_MAX_SOURCE_LEN) {
+        job->open_errno = EFBIG;
+        job->ok = false;
+        source_file_close(&file);
+        return;
+    }
+
+    job->ok = check_source(job, &file, file.data, file.len);
+    source_file_close(&file);
+}
+
+static void report(FileJob *job) {
+    if (job->open_errno != 0) {
+        fprintf(stderr, "%s: %s\n", job->path, strerror(job->open_errno));
+        return;
+    }
+    if (job->diagnostics != NULL) {
+        fwrite(job->diagnostics, 1, job->diagnostics_len, stderr);
+        free(job->diagnostics);
+    }
+    if (job->emit_errno != 0) {
+        fprintf(stderr, "%s: %s\n", job->emit_path != NULL ? job->emit_path : "<stdout>", strerror(job->emit_errno));
+    }
+    free(job->emit_path);
+    if (job->references != NULL) {
+        fwrite(job->references, 1, job->references_len, stdout);
+        free(job->references);
+    }
+    if (job->parse_res != PARSE_RESULT_OK) {
+        printf("%s: failed to parse: %s\n", job->path, parse_result_name(job->parse_res));
+    }
+}
+
+int main(int argc, char **argv) {
+    uint64_t start = trace_now_ns();
+    Options options = {
+            .pool = NULL,
+            .threads = pool_default_size(),
+            .token_mode = TOKEN_MODE_LAZY,
+            .cache_dir = getenv("TS_CACHE_DIR"),
+            .stats = false,
+            .trace = NULL,
+            .emit_js = false,
+            .stream = false,
+            .references = NULL,
+    };
+    FileJob *jobs = calloc(argc > 1 ? argc : 1, sizeof(FileJob));
+    int job_count = 0;
+    bool serve = false;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            options.threads = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--tokens=", 9) == 0) {
+            if (!token_mode_parse(argv[i] + 9, &options.token_mode)) {
+                fprintf(stderr, "unknown token mode: %s (expected lazy, array or pipeline)\n", argv[i] + 9);
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--cache-dir=", 12) == 0) {
+            options.cache_dir = argv[i] + 12;
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            serve = true;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            options.stream = true;
+        } else if (strcmp(argv[i], "--emit-js") == 0) {
+            options.emit_js = true;
+        } else if (strncmp(argv[i], "--references=", 13) == 0) {
+            options.references = argv[i] + 13;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = true;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            options.trace = trace_open(argv[i] + 8);
+            if (options.trace == NULL) {
+                fprintf(stderr, "%s: %s\n", argv[i] + 8, strerror(errno));
+                return 1;
+            }
+        } else {
+            jobs[job_count].options = &options;
+            jobs[job_count++].path = argv[i];
+        }
+    }
+
+    if (options.stream && (options.emit_js || options.references != NULL)) {
+        fprintf(stderr, "--stream keeps no statements to emit or references to list\n");
         return 1;
     }
 
-    return 0;
+    if (serve) {
+        free(jobs);
+        return serve_run(stdin, stdout);
+    }
+
+    if (job_count == 0) {
+        const char *source = "let a = 1;\n"
+                             "let b: number = 2;\n"
+                             "let c = a = b;";
+        jobs[0].options = &options;
+        jobs[0].path = "<builtin>";
+        jobs[0].ok = check_source(&jobs[0], NULL, source, strlen(source));
+        job_count = 1;
+    } else {
+        options.pool = pool_create(options.threads);
+        PoolGroup group;
+        pool_group_init(&group);
+        for (int i = 0; i < job_count; i++) {
+            pool_submit(options.pool, &group, check_file, &jobs[i]);
+        }
+        pool_wait(options.pool, &group);
+        pool_destroy(options.pool);
+    }
+
+    int status = 0;
+    Stats total = {0};
+    for (int i = 0; i < job_count; i++) {
+        report(&jobs[i]);
+        stats_add(&total, &jobs[i].stats);
+        if (!jobs[i].ok) {
+            status = 1;
+        }
+    }
+
+    if (options.trace != NULL) {
+        trace_close(options.trace);
+    }
+    if (options.stats) {
+        stats_print(stderr, &total, trace_now_ns() - start);
+    }
+
+    free(jobs);
+    return status;
 }
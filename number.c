@@ -0,0 +1,219 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "number.h"
+
+// Every power of ten up to 1e22 is exact in a double.
+static const double powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+#define NUMBER_MAX_EXACT_POWER 22
+#define NUMBER_MAX_EXACT_MANTISSA ((uint64_t) 1 << 53)
+// Nineteen decimal digits always fit in a uint64_t.
+#define NUMBER_MAX_MANTISSA_DIGITS 19
+// Larger exponents over- or underflow anyway; capping them keeps the
+// arithmetic in range.
+#define NUMBER_MAX_EXPONENT 100000
+
+// The value of a digit in any radix up to 16, or 255.
+static inline unsigned digit_value(char c) {
+    unsigned digit = (unsigned char) c - '0';
+    if (digit < 10) {
+        return digit;
+    }
+    unsigned letter = ((unsigned char) c | 0x20) - 'a';
+    return letter < 6 ? letter + 10 : 255;
+}
+
+// Returns the end of a run of digits in `radix`. Separators must sit
+// between two digits of the run; a misplaced one clears *valid.
+static size_t digit_run_end(const char *source, size_t pos, size_t len, unsigned radix, bool *valid) {
+    size_t begin = pos;
+    while (pos < len) {
+        char c = source[pos];
+        if (digit_value(c) < radix) {
+            pos++;
+            continue;
+        }
+        if (c != '_') {
+            break;
+        }
+        if (pos == begin || source[pos - 1] == '_' || pos + 1 >= len || digit_value(source[pos + 1]) >= radix) {
+            *valid = false;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+// 0x, 0b and 0o literals. Digits past the 64 bits the mantissa holds only
+// scale it, but a nonzero one is kept as a sticky low bit so the final
+// conversion still rounds correctly.
+static size_t scan_radix(const char *source, size_t pos, size_t len, unsigned bits, double *value, bool *valid) {
+    size_t begin = pos;
+    size_t end = digit_run_end(source, pos, len, 1u << bits, valid);
+    if (end == begin || source[begin] == '_') {
+        *valid = false;
+    }
+
+    uint64_t mantissa = 0;
+    int dropped_bits = 0;
+    bool sticky = false;
+    for (size_t i = begin; i < end; i++) {
+        if (source[i] == '_') {
+            continue;
+        }
+        unsigned digit = digit_value(source[i]);
+        if (mantissa >> (64 - bits) != 0) {
+            dropped_bits += (int) bits;
+            sticky |= digit != 0;
+        } else {
+            mantissa = mantissa << bits | digit;
+        }
+    }
+    if (sticky) {
+        mantissa |= 1;
+    }
+    *value = ldexp((double) mantissa, dropped_bits);
+    return end;
+}
+
+static double strtod_without_separators(const char *source, size_t begin, size_t end) {
+    char buf[128];
+    size_t len = end - begin;
+    char *text = len < sizeof(buf) ? buf : malloc(len + 1);
+    size_t n = 0;
+    for (size_t i = begin; i < end; i++) {
+        if (source[i] != '_') {
+            text[n++] = source[i];
+        }
+    }
+    text[n] = '\0';
+    double value = strtod(text, NULL);
+    if (text != buf) {
+        free(text);
+    }
+    return value;
+}
+
+static size_t scan_decimal(const char *source, size_t pos, size_t len, double *value, bool *valid) {
+    size_t begin = pos;
+    // 0123 would be a legacy octal literal, and 0_1 isn't allowed either.
+    if (source[pos] == '0' && pos + 1 < len && (digit_value(source[pos + 1]) < 10 || source[pos + 1] == '_')) {
+        *valid = false;
+    }
+
+    size_t point = digit_run_end(source, pos, len, 10, valid);
+    size_t end = point;
+    if (end < len && source[end] == '.') {
+        end++;
+        if (end < len && source[end] == '_') {
+            *valid = false;
+        }
+        end = digit_run_end(source, end, len, 10, valid);
+    }
+    size_t digits_end = end;
+
+    int64_t exponent = 0;
+    if (end < len && (source[end] | 0x20) == 'e') {
+        end++;
+        bool negative = false;
+        if (end < len && (source[end] == '+' || source[end] == '-')) {
+            negative = source[end] == '-';
+            end++;
+        }
+        size_t exponent_begin = end;
+        end = digit_run_end(source, end, len, 10, valid);
+        if (end == exponent_begin || source[exponent_begin] == '_') {
+            *valid = false;
+        }
+        for (size_t i = exponent_begin; i < end; i++) {
+            if (source[i] != '_' && exponent < NUMBER_MAX_EXPONENT) {
+                exponent = exponent * 10 + (source[i] - '0');
+            }
+        }
+        if (negative) {
+            exponent = -exponent;
+        }
+    }
+
+    // value = mantissa * 10^exponent, from the first 19 significant digits.
+    uint64_t mantissa = 0;
+    int digits = 0;
+    bool truncated = false;
+    for (size_t i = begin; i < digits_end; i++) {
+        char c = source[i];
+        if (c == '_' || c == '.') {
+            continue;
+        }
+        unsigned digit = (unsigned) (c - '0');
+        bool fraction = i > point;
+        if (digits < NUMBER_MAX_MANTISSA_DIGITS) {
+            if (mantissa != 0 || digit != 0) {
+                mantissa = mantissa * 10 + digit;
+                digits++;
+            }
+            exponent -= fraction;
+        } else {
+            truncated |= digit != 0;
+            exponent += !fraction;
+        }
+    }
+
+    // Clinger's fast path: when both the mantissa and the power of ten are
+    // exact doubles, one correctly rounded multiply or divide gives the
+    // correctly rounded result.
+    if (mantissa == 0 && !truncated) {
+        *value = 0;
+    } else if (!truncated && mantissa <= NUMBER_MAX_EXACT_MANTISSA && exponent >= -NUMBER_MAX_EXACT_POWER
+               && exponent <= NUMBER_MAX_EXACT_POWER) {
+        *value = exponent < 0
+                 ? (double) mantissa / powers_of_ten[-exponent]
+                 : (double) mantissa * powers_of_ten[exponent];
+    } else {
+        *value = strtod_without_separators(source, begin, end);
+    }
+    return end;
+}
+
+bool number_scan(const char *source, size_t len, ScanKernel skip_digits, size_t *pos, double *value) {
+    size_t start = *pos;
+
+    // Plain integers are by far the most common literal.
+    size_t end = skip_digits(source, start, len);
+    bool plain = end == len || (!char_is(source[end], CHAR_IDENT) && source[end] != '.');
+    if (plain && end - start <= NUMBER_MAX_MANTISSA_DIGITS && (source[start] != '0' || end - start == 1)) {
+        uint64_t mantissa = 0;
+        for (size_t i = start; i < end; i++) {
+            mantissa = mantissa * 10 + (unsigned) (source[i] - '0');
+        }
+        *value = (double) mantissa;
+        *pos = end;
+        return true;
+    }
+
+    bool valid = true;
+    char prefix = start + 1 < len && source[start] == '0' ? (char) (source[start + 1] | 0x20) : '\0';
+    if (prefix == 'x') {
+        end = scan_radix(source, start + 2, len, 4, value, &valid);
+    } else if (prefix == 'b') {
+        end = scan_radix(source, start + 2, len, 1, value, &valid);
+    } else if (prefix == 'o') {
+        end = scan_radix(source, start + 2, len, 3, value, &valid);
+    } else {
+        end = scan_decimal(source, start, len, value, &valid);
+    }
+
+    // `1px` or `0x1g` is one malformed literal, not a number and a name.
+    if (end < len && char_is(source[end], CHAR_IDENT)) {
+        valid = false;
+        while (end < len && char_is(source[end], CHAR_IDENT)) {
+            end++;
+        }
+    }
+    *pos = end;
+    return valid;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "scan.h"
+
+// Scans the numeric literal at source[*pos], which starts with a digit or
+// with a '.' followed by one, and advances *pos past it. Handles decimals
+// with fraction and exponent, 0x/0b/0o integers and `_` separators between
+// digits.
+//
+// Returns false for a malformed literal: a misplaced separator, a missing
+// exponent or radix digit, a leading zero followed by more digits, or an
+// identifier character right after the literal. A malformed literal extends
+// over any identifier characters that follow it.
+//
+// Literals out of double range become infinity or zero, as in JavaScript.
+// Short literals take an exact fast path; the rest are handed to strtod.
+bool number_scan(const char *source, size_t len, ScanKernel skip_digits, size_t *pos, double *value);
@@ -1,4 +1,3 @@
-#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,8 +5,10 @@
 
 #include "ast.h"
 #include "bind.h"
+#include "diag.h"
 #include "lexer.h"
 #include "parser.h"
+#include "tokens.h"
 #include "vendor/stretchy_buffer.h"
 
 #define TRY_PARSE(__expr) \
@@ -20,10 +21,16 @@
     do {                  \
         if (parser->has_errors) break; \
         parser->has_errors = true; \
-        parser_print_error_context(parser); \
-        fprintf(stderr, __VA_ARGS__); \
+        Location __location = {.pos = parser_token(parser)->offset}; \
+        if (++parser->error_count > parser->max_errors) { \
+            parser_drop_error(parser, __location); \
+            break; \
+        } \
+        diagnostics_add(&parser->mod->diagnostics, parser->mod->arena, DIAGNOSTIC_SYNTAX, __location, __VA_ARGS__); \
     } while (0)
 
+#define PARSER_TOO_MANY_ERRORS "too many syntax errors; the rest are not reported"
+
 char *parse_result_name(ParseResult res) {
     switch (res) {
         case PARSE_RESULT_OK:
@@ -40,38 +47,47 @@ char *parse_result_name(ParseResult res) {
 Parser *parser_create(Lexer *lexer) {
     Parser *parser = malloc(sizeof(Parser));
     parser->lexer = lexer;
+    parser->mod = NULL;
+    parser->stats = NULL;
+    parser->trace = NULL;
+    parser->token_mode = TOKEN_MODE_LAZY;
     parser->has_errors = false;
+    parser->error_count = 0;
+    parser->max_errors = PARSER_MAX_ERRORS;
+    parser->expr_stack = NULL;
+    parser->stops = NULL;
+    parser->stop_count = 0;
+    parser->stop_index = 0;
+    parser->on_statement = NULL;
+    parser->on_statement_arg = NULL;
     return parser;
 }
 
-void parser_print_error_context(Parser *parser) {
-    size_t pos = parser->lexer->pos;
+void parser_destroy(Parser *parser) {
+    sb_free(parser->expr_stack);
+    free(parser);
+}
 
-    size_t line_start = pos;
-    size_t line_end = pos;
-    while (parser->lexer->source[line_start - 1] != '\n' && line_start > 0) {
-        line_start--;
-    }
-    while (parser->lexer->source[line_end] != '\n' && line_end < parser->lexer->source_len) {
-        line_end++;
-    }
+static inline const Token *parser_token(Parser *parser) {
+    return token_cursor_current(&parser->tokens);
+}
 
-    char *current_line = substr(parser->lexer->source, line_start, line_end + 1);
-    fprintf(stderr, "%s", current_line);
+static inline const Token *parser_prev_token(Parser *parser) {
+    return token_cursor_prev(&parser->tokens);
+}
 
-    size_t padding_size = pos - line_start - 1;
-    char *padding = malloc(sizeof(char) * padding_size);
-    for (size_t i = 0; i < padding_size; i++) {
-        padding[i] = ' ';
+// The first error past the cap is replaced by a note, and later ones are
+// dropped.
+static void parser_drop_error(Parser *parser, Location location) {
+    if (parser->error_count == parser->max_errors + 1) {
+        diagnostics_add(&parser->mod->diagnostics, parser->mod->arena, DIAGNOSTIC_SYNTAX, location, PARSER_TOO_MANY_ERRORS);
     }
-
-    fprintf(stderr, "%s^ ", padding);
 }
 
 bool parser_try_parse_token(Parser *parser, TokenType type) {
-    bool ok = parser->lexer->token != NULL && parser->lexer->token->type == type;
+    bool ok = parser_token(parser)->type == type;
     if (ok) {
-        lexer_scan(parser->lexer);
+        token_cursor_advance(&parser->tokens);
     }
     return ok;
 }
@@ -79,85 +95,111 @@ bool parser_try_parse_token(Parser *parser, TokenType type) {
 ParseResult parser_expect_token(Parser *parser, TokenType type) {
     bool ok = parser_try_parse_token(parser, type);
     if (!ok) {
-        PARSER_ERROR("expected a token of type %s, got %s\n",
+        PARSER_ERROR("expected a token of type %s, got %s",
                      token_type_name(type),
-                     token_type_name(parser->lexer->token->type));
+                     token_type_name(parser_token(parser)->type));
         return PARSE_RESULT_UNEXPECTED_TOK;
     }
     return PARSE_RESULT_OK;
 }
 
-ParseResult parse_identifier_or_literal(Parser *parser, Expr *expr) {
-    size_t pos = parser->lexer->pos;
-    Location location = {.pos = pos};
-    if (parser_try_parse_token(parser, TOK_IDENT)) {
-        *expr = expr_ident_create(location, parser->lexer->token->text);
-        return PARSE_RESULT_OK;
-    }
+ParseResult parse_number(Parser *parser, NodeId *expr) {
+    // The lexer has already computed the value.
+    const Token *token = parser_prev_token(parser);
+    Location location = {.pos = token->offset};
+    *expr = expr_num_create(&parser->mod->ast, location, token->number);
+    return PARSE_RESULT_OK;
+}
 
-    if (parser_try_parse_token(parser, TOK_NUMBER)) {
-        char *end_ptr;
-        double value = strtod(parser->lexer->token->text, &end_ptr);
-        if (errno == ERANGE) {
-            PARSER_ERROR("could not parse as double: %s\n", parser->lexer->token->text);
-            return PARSE_RESULT_INVALID_NUMERIC_LITERAL;
-        }
-        *expr = expr_num_create(location, value);
-        return PARSE_RESULT_OK;
+// Parses an operand and reduces the operators stacked up before it. The
+// only operator so far is assignment, which is right-associative and binds
+// loosest, so `a = b = c` stacks `a =` and `b =` and reduces both once `c`
+// is parsed. Chains of any length use constant native stack. Binary
+// operators would reduce the frames that bind at least as tightly before
+// stacking themselves.
+ParseResult parse_expression(Parser *parser, NodeId *expr) {
+    Ast *ast = &parser->mod->ast;
+    if (parser->expr_stack != NULL) {
+        stb__sbn(parser->expr_stack) = 0;
     }
 
-    PARSER_ERROR("expected identifier or a literal but got %s\n", token_type_name(parser->lexer->token->type));
-    return PARSE_RESULT_UNEXPECTED_TOK;
-}
+    NodeId operand;
+    while (true) {
+        Location location = {.pos = parser_token(parser)->offset};
+        if (parser_try_parse_token(parser, TOK_IDENT)) {
+            int name = parser_prev_token(parser)->id;
+            if (parser_try_parse_token(parser, TOK_EQ)) {
+                ExprFrame frame = {.location = location, .name = name};
+                sb_push(parser->expr_stack, frame);
+                continue;
+            }
+            operand = expr_ident_create(ast, location, name);
+            break;
+        }
 
-ParseResult parse_expression(Parser *parser, Expr *expr) {
-    size_t pos = parser->lexer->pos;
-    Location location = {.pos = pos};
+        if (parser_try_parse_token(parser, TOK_NUMBER)) {
+            TRY_PARSE(parse_number(parser, &operand));
+            break;
+        }
 
-    TRY_PARSE(parse_identifier_or_literal(parser, expr));
+        if (parser_token(parser)->type == TOK_INVALID_NUMBER) {
+            Span span = token_span(parser_token(parser));
+            PARSER_ERROR("invalid numeric literal %.*s", (int) span.len, span_text(parser->lexer->source, span));
+            // Skip it, so recovery resumes after the literal rather than
+            // reporting it again as an unexpected token.
+            token_cursor_advance(&parser->tokens);
+            return PARSE_RESULT_INVALID_NUMERIC_LITERAL;
+        }
 
-    if (expr->type == EXPR_IDENT && parser_try_parse_token(parser, TOK_EQ)) {
-        Expr *value = malloc(sizeof(Expr));
-        TRY_PARSE(parse_expression(parser, value));
-        *expr = expr_assignment_create(location, expr->ident, value);
+        PARSER_ERROR("expected identifier or a literal but got %s", token_type_name(parser_token(parser)->type));
+        return PARSE_RESULT_UNEXPECTED_TOK;
     }
 
+    for (int i = sb_count(parser->expr_stack) - 1; i >= 0; i--) {
+        ExprFrame frame = parser->expr_stack[i];
+        operand = expr_assignment_create(ast, frame.location, frame.name, operand);
+    }
+    *expr = operand;
     return PARSE_RESULT_OK;
 }
 
 ParseResult parse_identifier(Parser *parser, Ident *ident) {
-    Expr expr;
-    TRY_PARSE(parse_identifier_or_literal(parser, &expr));
-    if (expr.type == EXPR_IDENT) {
-        *ident = expr.ident;
+    if (parser_try_parse_token(parser, TOK_IDENT)) {
+        const Token *token = parser_prev_token(parser);
+        *ident = ident_create(token_span(token), token->id);
         return PARSE_RESULT_OK;
     }
 
-    PARSER_ERROR("expected identifier but got a literal\n");
+    if (parser_try_parse_token(parser, TOK_NUMBER)) {
+        PARSER_ERROR("expected identifier but got a literal");
+        return PARSE_RESULT_UNEXPECTED_TOK;
+    }
+
+    PARSER_ERROR("expected identifier or a literal but got %s", token_type_name(parser_token(parser)->type));
     return PARSE_RESULT_UNEXPECTED_TOK;
 }
 
-ParseResult parse_stmt(Parser *parser, Stmt *stmt) {
-    size_t pos = parser->lexer->pos;
-    Location location = {.pos = pos};
+ParseResult parse_stmt(Parser *parser, NodeId *stmt) {
+    Location location = {.pos = parser_token(parser)->offset};
+    Ast *ast = &parser->mod->ast;
 
     if (parser_try_parse_token(parser, TOK_LET)) {
         // let $name: $type_name = $expr;
         Ident name;
         TRY_PARSE(parse_identifier(parser, &name));
 
-        Ident *type_name = NULL;
+        int type_name = -1;
         if (parser_try_parse_token(parser, TOK_COLON)) {
-            type_name = malloc(sizeof(Ident));
-            TRY_PARSE(parse_identifier(parser, type_name));
+            Ident type;
+            TRY_PARSE(parse_identifier(parser, &type));
+            type_name = type.id;
         }
 
         TRY_PARSE(parser_expect_token(parser, TOK_EQ));
 
-        Expr init;
+        NodeId init;
         TRY_PARSE(parse_expression(parser, &init));
-        Decl decl = decl_let_create(location, name, type_name, init);
-        *stmt = stmt_decl_create(location, decl);
+        *stmt = decl_let_create(ast, location, name.id, type_name, init);
     } else if (parser_try_parse_token(parser, TOK_TYPE)) {
         // type $name = $type_name;
         Ident name;
@@ -168,29 +210,30 @@ ParseResult parse_stmt(Parser *parser, Stmt *stmt) {
         Ident type_name;
         TRY_PARSE(parse_identifier(parser, &type_name));
 
-        Decl decl = decl_type_alias_create(location, name, type_name);
-        *stmt = stmt_decl_create(location, decl);
+        *stmt = decl_type_alias_create(ast, location, name.id, type_name.id);
     } else {
         // $expr;
-        Expr expr;
-        TRY_PARSE(parse_expression(parser, &expr));
-        *stmt = stmt_expr_create(location, expr);
+        TRY_PARSE(parse_expression(parser, stmt));
     }
 
     TRY_PARSE(parser_expect_token(parser, TOK_SEMICOLON));
     return PARSE_RESULT_OK;
 }
 
-void parser_synchronize(Parser *parser) {
-    lexer_scan(parser->lexer);
+// Skips the rest of a statement that started at `start` and failed to
+// parse: up to just after the next ';', or to the next keyword that starts a
+// statement. A missing ';' then costs only the statement that lacks it.
+void parser_synchronize(Parser *parser, size_t start) {
+    if (parser_token(parser)->offset == start) {
+        token_cursor_advance(&parser->tokens);
+    }
 
-    while (!lexer_has_more_chars(parser->lexer)) {
-        Token *prev_token = parser->lexer->prev_token;
-        if (prev_token != NULL && prev_token->type == TOK_SEMICOLON) {
+    while (parser_token(parser)->type != TOK_END_OF_FILE) {
+        if (parser_prev_token(parser)->type == TOK_SEMICOLON) {
             return;
         }
 
-        switch (parser->lexer->token->type) {
+        switch (parser_token(parser)->type) {
             case TOK_LET:
             case TOK_FUNCTION:
             case TOK_TYPE:
@@ -200,34 +243,162 @@ void parser_synchronize(Parser *parser) {
                 break;
         }
 
-        lexer_scan(parser->lexer);
+        token_cursor_advance(&parser->tokens);
     }
 }
 
-ParseResult parser_parse_module(Parser *parser, Module *mod) {
-    lexer_scan(parser->lexer);
-    if (parser_try_parse_token(parser, TOK_END_OF_FILE)) {
-        return PARSE_RESULT_OK;
+static bool parser_at_stop(Parser *parser) {
+    size_t pos = parser_token(parser)->offset;
+    while (parser->stop_index < parser->stop_count && parser->stops[parser->stop_index] < pos) {
+        parser->stop_index++;
     }
+    return parser->stop_index < parser->stop_count && parser->stops[parser->stop_index] == pos;
+}
 
-    ParseResult res;
+static ParseResult parser_parse_statements(Parser *parser, Module *mod) {
+    ParseResult res = PARSE_RESULT_OK;
     while (true) {
-        Stmt stmt;
-        res = parse_stmt(parser, &stmt);
-        if (res != PARSE_RESULT_OK) {
-            parser_synchronize(parser);
-            parser->has_errors = false;
+        if (parser->stop_count > 0 && parser_at_stop(parser)) {
+            break;
         }
-        sb_push(mod->statements, stmt);
-
         if (parser_try_parse_token(parser, TOK_END_OF_FILE)) {
+            parser->stop_index = parser->stop_count;
             break;
         }
+
+        NodeId stmt = AST_NONE;
+        size_t stmt_start = parser_token(parser)->offset;
+        uint64_t start = parser->trace != NULL ? trace_now_ns() : 0;
+        ParseResult stmt_res = parse_stmt(parser, &stmt);
+        if (parser->trace != NULL) {
+            trace_span(parser->trace, TRACE_TRACK_MAIN, "parse_stmt", start, trace_now_ns(), NULL);
+        }
+        if (stmt_res != PARSE_RESULT_OK) {
+            if (res == PARSE_RESULT_OK) {
+                res = stmt_res;
+            }
+            parser_synchronize(parser, stmt_start);
+            parser->has_errors = false;
+        } else if (parser->on_statement != NULL) {
+            parser->on_statement(parser->on_statement_arg, stmt);
+        } else {
+            sb_push(mod->statements, stmt);
+        }
     }
+    return res;
+}
 
+ParseResult parser_parse_module(Parser *parser, Module *mod) {
+    parser->mod = mod;
+    parser->lexer->stats = parser->stats;
+    parser->lexer->trace = parser->trace;
+
+    uint64_t start = parser->stats != NULL ? trace_now_ns() : 0;
+    uint64_t lex_start_ns = parser->stats != NULL ? parser->stats->lex_ns : 0;
+
+    token_cursor_init(&parser->tokens, parser->lexer, parser->token_mode);
+    ParseResult res = parser_parse_statements(parser, mod);
+    token_cursor_destroy(&parser->tokens);
+    line_starts_append(&mod->line_starts, parser->lexer->line_starts);
+
+    if (parser->stats != NULL) {
+        // Pipelined lexing overlaps parsing, so only the time spent waiting
+        // for tokens is taken out of the parse time.
+        uint64_t lex_ns = parser->token_mode == TOKEN_MODE_PIPELINE
+                          ? parser->tokens.stall_ns
+                          : parser->stats->lex_ns - lex_start_ns;
+        parser->stats->parse_ns += trace_now_ns() - start - lex_ns;
+    }
     return res;
 }
 
 ParseResult parser_parse(Parser *parser, Module *module) {
     return parser_parse_module(parser, module);
 }
+
+typedef struct {
+    Module *mod;
+    size_t start;
+    size_t end;
+    ParseResult res;
+    int errors;
+    Stats stats;
+    bool collect_stats;
+    Trace *trace;
+} ParseChunk;
+
+static void parse_chunk(void *arg) {
+    ParseChunk *chunk = arg;
+    // The chunk lexer sees the whole source up to the chunk end, so spans
+    // and locations come out as absolute offsets.
+    Lexer *lexer = lexer_create(chunk->mod->source, chunk->end, chunk->mod->arena, chunk->mod->names);
+    lexer->pos = chunk->start;
+    Parser *parser = parser_create(lexer);
+    parser->stats = chunk->collect_stats ? &chunk->stats : NULL;
+    parser->trace = chunk->trace;
+    chunk->res = parser_parse(parser, chunk->mod);
+    chunk->errors = parser->error_count;
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+}
+
+ParseResult parser_parse_chunked(Module *mod, Pool *pool, int chunk_count, Stats *stats, Trace *trace) {
+    // There are no strings, comments or blocks yet, so every ';' ends a
+    // top-level statement.
+    ParseChunk *chunks = NULL;
+    size_t start = 0;
+    for (int i = 1; i <= chunk_count && start < mod->source_len; i++) {
+        size_t end = mod->source_len;
+        if (i < chunk_count) {
+            size_t target = mod->source_len / chunk_count * i;
+            if (target < start) {
+                target = start;
+            }
+            const char *semi = memchr(mod->source + target, ';', mod->source_len - target);
+            end = semi != NULL ? (size_t) (semi - mod->source) + 1 : mod->source_len;
+        }
+
+        ParseChunk chunk = {
+                .mod = module_create(mod->source, mod->source_len),
+                .start = start,
+                .end = end,
+                .res = PARSE_RESULT_OK,
+                .errors = 0,
+                .stats = {0},
+                .collect_stats = stats != NULL,
+                .trace = trace,
+        };
+        sb_push(chunks, chunk);
+        start = end;
+    }
+
+    PoolGroup group;
+    pool_group_init(&group);
+    for (int i = 0; i < sb_count(chunks); i++) {
+        pool_submit(pool, &group, parse_chunk, &chunks[i]);
+    }
+    pool_wait(pool, &group);
+
+    ParseResult res = PARSE_RESULT_OK;
+    int errors = 0;
+    for (int i = 0; i < sb_count(chunks); i++) {
+        if (res == PARSE_RESULT_OK) {
+            res = chunks[i].res;
+        }
+        errors += chunks[i].errors;
+        if (stats != NULL) {
+            stats_add(stats, &chunks[i].stats);
+        }
+        module_append(mod, chunks[i].mod);
+    }
+    sb_free(chunks);
+
+    // Each chunk capped its errors on its own. Errors come out in source
+    // order, so cutting the list after the cap gives what one parser would
+    // have reported.
+    if (errors > PARSER_MAX_ERRORS) {
+        mod->diagnostics[PARSER_MAX_ERRORS].message = PARSER_TOO_MANY_ERRORS;
+        stb__sbn(mod->diagnostics) = PARSER_MAX_ERRORS + 1;
+    }
+    return res;
+}
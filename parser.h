@@ -2,10 +2,47 @@
 
 #include "bind.h"
 #include "lexer.h"
+#include "pool.h"
+#include "tokens.h"
+
+#define PARSER_MAX_ERRORS 100
+
+// An assignment whose target has been parsed but whose value hasn't.
+typedef struct {
+    Location location;
+    int name;
+} ExprFrame;
 
 typedef struct {
     Lexer *lexer;
+    // How tokens are produced; set before parsing. Chunked parses always
+    // lex lazily since every pool thread is already parsing.
+    TokenMode token_mode;
+    TokenCursor tokens;
+    Module *mod;
+    // Set once the current statement has reported its error.
     bool has_errors;
+    // Statements that failed to parse. Only the first max_errors are
+    // reported, followed by one diagnostic saying the rest were not.
+    int error_count;
+    int max_errors;
+    // parse_expression's operator stack, kept between expressions.
+    ExprFrame *expr_stack;
+    // Optional instrumentation, passed on to the lexer. parse_ns excludes
+    // time spent lexing.
+    Stats *stats;
+    Trace *trace;
+    // Optional sorted offsets of statements that follow an edit. Parsing
+    // stops early once it is between statements at one of them, leaving
+    // stop_index on that entry; stop_index ends up at stop_count if the
+    // parser reaches the end of the input instead.
+    const size_t *stops;
+    int stop_count;
+    int stop_index;
+    // Optional; when set, each parsed statement is handed to it instead of
+    // being appended to mod->statements.
+    void (*on_statement)(void *arg, NodeId stmt);
+    void *on_statement_arg;
 } Parser;
 
 typedef enum {
@@ -18,4 +55,14 @@ char *parse_result_name(ParseResult res);
 
 Parser *parser_create(Lexer *lexer);
 
+void parser_destroy(Parser *parser);
+
+// Parses every statement, recovering from a syntax error by skipping to the
+// start of the next statement, so that one pass reports every independent
+// error. Returns the result of the first statement that failed.
 ParseResult parser_parse(Parser *parser, Module *module);
+
+// Splits the module source at top-level statement boundaries and parses the
+// pieces concurrently on `pool`. Produces the same statements as
+// parser_parse() for well-formed input.
+ParseResult parser_parse_chunked(Module *mod, Pool *pool, int chunk_count, Stats *stats, Trace *trace);
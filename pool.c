@@ -0,0 +1,231 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+typedef struct {
+    PoolTask task;
+    void *arg;
+    PoolGroup *group;
+} PoolJob;
+
+// A double-ended queue of jobs. The owning thread pushes and pops at the
+// bottom; idle threads steal the oldest job from the top.
+typedef struct {
+    pthread_mutex_t lock;
+    PoolJob *jobs;
+    size_t top;
+    size_t bottom;
+    size_t cap;
+} PoolDeque;
+
+struct Pool_ {
+    // One deque per worker thread, plus a final one that other threads
+    // submit into.
+    PoolDeque *deques;
+    int deque_count;
+    pthread_t *threads;
+    int thread_count;
+
+    pthread_mutex_t lock;
+    // Signalled when a job is queued and broadcast when a group finishes,
+    // so it wakes both idle workers and threads in pool_wait.
+    pthread_cond_t wake;
+    atomic_int queued;
+    bool shutdown;
+};
+
+typedef struct {
+    Pool *pool;
+    int index;
+} PoolWorker;
+
+static _Thread_local Pool *pool_current_ = NULL;
+static _Thread_local int pool_current_index_ = -1;
+
+int pool_default_size(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+}
+
+static void pool_deque_init(PoolDeque *deque) {
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->cap = 64;
+    deque->jobs = malloc(sizeof(PoolJob) * deque->cap);
+    deque->top = 0;
+    deque->bottom = 0;
+}
+
+static void pool_deque_push(PoolDeque *deque, PoolJob job) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->cap) {
+        PoolJob *jobs = malloc(sizeof(PoolJob) * deque->cap * 2);
+        for (size_t i = deque->top; i < deque->bottom; i++) {
+            jobs[i % (deque->cap * 2)] = deque->jobs[i % deque->cap];
+        }
+        free(deque->jobs);
+        deque->jobs = jobs;
+        deque->cap *= 2;
+    }
+    deque->jobs[deque->bottom % deque->cap] = job;
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool pool_deque_pop(PoolDeque *deque, PoolJob *job) {
+    pthread_mutex_lock(&deque->lock);
+    bool ok = deque->bottom > deque->top;
+    if (ok) {
+        deque->bottom--;
+        *job = deque->jobs[deque->bottom % deque->cap];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return ok;
+}
+
+static bool pool_deque_steal(PoolDeque *deque, PoolJob *job) {
+    pthread_mutex_lock(&deque->lock);
+    bool ok = deque->bottom > deque->top;
+    if (ok) {
+        *job = deque->jobs[deque->top % deque->cap];
+        deque->top++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return ok;
+}
+
+static int pool_home_deque(Pool *pool) {
+    return pool_current_ == pool ? pool_current_index_ : pool->deque_count - 1;
+}
+
+static bool pool_take(Pool *pool, PoolJob *job) {
+    int home = pool_home_deque(pool);
+    if (pool_deque_pop(&pool->deques[home], job)) {
+        atomic_fetch_sub(&pool->queued, 1);
+        return true;
+    }
+    for (int i = 1; i < pool->deque_count; i++) {
+        if (pool_deque_steal(&pool->deques[(home + i) % pool->deque_count], job)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void pool_run(Pool *pool, PoolJob job) {
+    job.task(job.arg);
+    if (atomic_fetch_sub(&job.group->pending, 1) == 1) {
+        // Under the lock, so a waiter between checking `pending` and
+        // sleeping can't miss it.
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *pool_worker_main(void *arg) {
+    PoolWorker *worker = arg;
+    Pool *pool = worker->pool;
+    pool_current_ = pool;
+    pool_current_index_ = worker->index;
+    free(worker);
+
+    while (true) {
+        PoolJob job;
+        if (pool_take(pool, &job)) {
+            pool_run(pool, job);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        bool shutdown = pool->shutdown;
+        pthread_mutex_unlock(&pool->lock);
+        if (shutdown) {
+            return NULL;
+        }
+    }
+}
+
+Pool *pool_create(int threads) {
+    Pool *pool = malloc(sizeof(Pool));
+    pool->thread_count = threads > 1 ? threads - 1 : 0;
+    pool->deque_count = pool->thread_count + 1;
+    pool->deques = malloc(sizeof(PoolDeque) * pool->deque_count);
+    for (int i = 0; i < pool->deque_count; i++) {
+        pool_deque_init(&pool->deques[i]);
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->queued, 0);
+    pool->shutdown = false;
+
+    pool->threads = malloc(sizeof(pthread_t) * (pool->thread_count > 0 ? pool->thread_count : 1));
+    for (int i = 0; i < pool->thread_count; i++) {
+        PoolWorker *worker = malloc(sizeof(PoolWorker));
+        worker->pool = pool;
+        worker->index = i;
+        pthread_create(&pool->threads[i], NULL, pool_worker_main, worker);
+    }
+    return pool;
+}
+
+void pool_destroy(Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (int i = 0; i < pool->deque_count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].jobs);
+    }
+    free(pool->deques);
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool);
+}
+
+void pool_group_init(PoolGroup *group) {
+    atomic_init(&group->pending, 0);
+}
+
+void pool_submit(Pool *pool, PoolGroup *group, PoolTask task, void *arg) {
+    atomic_fetch_add(&group->pending, 1);
+    PoolJob job = {.task = task, .arg = arg, .group = group};
+    pool_deque_push(&pool->deques[pool_home_deque(pool)], job);
+
+    // Take the lock so a worker between checking `queued` and sleeping
+    // can't miss the wakeup.
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add(&pool->queued, 1);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_wait(Pool *pool, PoolGroup *group) {
+    while (atomic_load(&group->pending) > 0) {
+        PoolJob job;
+        if (pool_take(pool, &job)) {
+            pool_run(pool, job);
+            continue;
+        }
+
+        // The group's last jobs are running elsewhere; sleep until one of
+        // them finishes it or more work is queued.
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&group->pending) > 0 && atomic_load(&pool->queued) == 0) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdatomic.h>
+
+typedef void (*PoolTask)(void *arg);
+
+// Tracks a batch of submitted tasks so a caller can wait for just those.
+typedef struct {
+    atomic_int pending;
+} PoolGroup;
+
+typedef struct Pool_ Pool;
+
+int pool_default_size(void);
+
+// Creates a pool that runs tasks on `threads` threads in total, counting the
+// thread that waits on them.
+Pool *pool_create(int threads);
+
+void pool_destroy(Pool *pool);
+
+void pool_group_init(PoolGroup *group);
+
+void pool_submit(Pool *pool, PoolGroup *group, PoolTask task, void *arg);
+
+// Runs queued tasks on the calling thread until every task in `group` has
+// finished, so it is safe to call from inside a task.
+void pool_wait(Pool *pool, PoolGroup *group);
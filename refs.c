@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "refs.h"
+#include "vendor/stretchy_buffer.h"
+
+typedef struct {
+    RefIndex *index;
+    // Per name id: the previous use.
+    uint32_t *last;
+    // Name ids in order of first use.
+    int *used;
+    bool write;
+} RefBuilder;
+
+static size_t varint_len(size_t value) {
+    size_t len = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        len++;
+    }
+    return len;
+}
+
+static void ref_builder_use(RefBuilder *builder, int name, size_t pos) {
+    RefIndex *index = builder->index;
+    size_t delta = pos - builder->last[name];
+    builder->last[name] = (uint32_t) pos;
+    if (!builder->write) {
+        if (index->counts[name]++ == 0) {
+            sb_push(builder->used, name);
+        }
+        index->offsets[name] += varint_len(delta);
+        return;
+    }
+    uint8_t *out = index->bytes + index->offsets[name];
+    while (delta >= 0x80) {
+        *out++ = (uint8_t) (delta | 0x80);
+        delta >>= 7;
+    }
+    *out++ = (uint8_t) delta;
+    index->offsets[name] = (size_t) (out - index->bytes);
+}
+
+static void ref_builder_walk(RefBuilder *builder, const Ast *ast, const NodeId *statements, int count) {
+    for (int i = 0; i < count; i++) {
+        NodeId node = statements[i];
+        NodeKind kind = ast_kind(ast, node);
+        if (kind == NODE_DECL_TYPE_ALIAS) {
+            continue;
+        }
+        if (kind == NODE_DECL_LET) {
+            node = decl_let_init(ast, node);
+            // Streamed modules keep lets without their initializers.
+            if (node == AST_NONE) {
+                continue;
+            }
+        }
+        // Assignment chains nest to the right, so follow them in a loop.
+        while (ast_kind(ast, node) == NODE_EXPR_ASSIGNMENT) {
+            ref_builder_use(builder, node_name(ast, node), ast_location(ast, node).pos);
+            node = expr_assignment_value(ast, node);
+        }
+        if (ast_kind(ast, node) == NODE_EXPR_IDENT) {
+            ref_builder_use(builder, node_name(ast, node), ast_location(ast, node).pos);
+        }
+    }
+}
+
+RefIndex *ref_index_build(const Ast *ast, const NodeId *statements, int count, int name_count) {
+    RefIndex *index = malloc(sizeof(RefIndex));
+    size_t names = name_count > 0 ? (size_t) name_count : 1;
+    index->name_count = name_count;
+    // Only the entries of names that are used are ever touched, so large
+    // modules with few uses don't pay for every name.
+    index->offsets = calloc(names, sizeof(size_t));
+    index->counts = calloc(names, sizeof(uint32_t));
+
+    // The first walk sizes each name's deltas, the second writes them.
+    RefBuilder builder = {
+            .index = index,
+            .last = calloc(names, sizeof(uint32_t)),
+            .used = NULL,
+            .write = false,
+    };
+    ref_builder_walk(&builder, ast, statements, count);
+
+    size_t total = 0;
+    for (int i = 0; i < sb_count(builder.used); i++) {
+        int name = builder.used[i];
+        size_t size = index->offsets[name];
+        index->offsets[name] = total;
+        total += size;
+        builder.last[name] = 0;
+    }
+    index->bytes = malloc(total > 0 ? total : 1);
+    builder.write = true;
+    if (total > 0) {
+        ref_builder_walk(&builder, ast, statements, count);
+    }
+
+    // Writing left each offset at the end of its name's deltas, which is
+    // where the next used name's begin.
+    size_t begin = 0;
+    for (int i = 0; i < sb_count(builder.used); i++) {
+        int name = builder.used[i];
+        size_t end = index->offsets[name];
+        index->offsets[name] = begin;
+        begin = end;
+    }
+
+    free(builder.last);
+    sb_free(builder.used);
+    return index;
+}
+
+void ref_index_destroy(RefIndex *index) {
+    if (index == NULL) {
+        return;
+    }
+    free(index->offsets);
+    free(index->counts);
+    free(index->bytes);
+    free(index);
+}
+
+uint32_t ref_index_count(const RefIndex *index, int name) {
+    return name >= 0 && name < index->name_count ? index->counts[name] : 0;
+}
+
+RefCursor ref_index_find(const RefIndex *index, int name) {
+    RefCursor cursor = {.next = NULL, .remaining = ref_index_count(index, name), .pos = 0};
+    if (cursor.remaining > 0) {
+        cursor.next = index->bytes + index->offsets[name];
+    }
+    return cursor;
+}
+
+bool ref_cursor_next(RefCursor *cursor, size_t *pos) {
+    if (cursor->remaining == 0) {
+        return false;
+    }
+    size_t delta = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *cursor->next++;
+        delta |= (size_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    cursor->remaining--;
+    cursor->pos += delta;
+    *pos = cursor->pos;
+    return true;
+}
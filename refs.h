@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ast.h"
+
+// Inverted index from name id to the positions of the identifier and
+// assignment expressions that use the name. Each name's positions are kept
+// in source order as varint-encoded deltas from the previous one, packed
+// into one byte buffer, so finding the uses of a name costs O(uses) rather
+// than a walk over the module.
+typedef struct {
+    int name_count;
+    // Per name id: where its deltas start in `bytes`, and how many uses
+    // there are.
+    size_t *offsets;
+    uint32_t *counts;
+    uint8_t *bytes;
+} RefIndex;
+
+// Walks the expressions of the `count` statements, which must be in source
+// order.
+RefIndex *ref_index_build(const Ast *ast, const NodeId *statements, int count, int name_count);
+
+void ref_index_destroy(RefIndex *index);
+
+// Number of uses of `name`; 0 for names the index doesn't know.
+uint32_t ref_index_count(const RefIndex *index, int name);
+
+typedef struct {
+    const uint8_t *next;
+    uint32_t remaining;
+    size_t pos;
+} RefCursor;
+
+RefCursor ref_index_find(const RefIndex *index, int name);
+
+// Stores the next use position in *pos, or returns false after the last.
+bool ref_cursor_next(RefCursor *cursor, size_t *pos);
@@ -0,0 +1,183 @@
+#include <stdint.h>
+
+#include "scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#define DIGIT (CHAR_DIGIT | CHAR_IDENT)
+#define ALPHA (CHAR_IDENT_START | CHAR_IDENT)
+
+const unsigned char char_class[256] = {
+        [' '] = CHAR_SPACE, ['\t'] = CHAR_SPACE, ['\n'] = CHAR_SPACE,
+        ['\v'] = CHAR_SPACE, ['\f'] = CHAR_SPACE, ['\r'] = CHAR_SPACE,
+        ['0'] = DIGIT, ['1'] = DIGIT, ['2'] = DIGIT, ['3'] = DIGIT, ['4'] = DIGIT, ['5'] = DIGIT,
+        ['6'] = DIGIT, ['7'] = DIGIT, ['8'] = DIGIT, ['9'] = DIGIT,
+        ['A'] = ALPHA, ['B'] = ALPHA, ['C'] = ALPHA, ['D'] = ALPHA, ['E'] = ALPHA, ['F'] = ALPHA,
+        ['G'] = ALPHA, ['H'] = ALPHA, ['I'] = ALPHA, ['J'] = ALPHA, ['K'] = ALPHA, ['L'] = ALPHA,
+        ['M'] = ALPHA, ['N'] = ALPHA, ['O'] = ALPHA, ['P'] = ALPHA, ['Q'] = ALPHA, ['R'] = ALPHA,
+        ['S'] = ALPHA, ['T'] = ALPHA, ['U'] = ALPHA, ['V'] = ALPHA, ['W'] = ALPHA, ['X'] = ALPHA,
+        ['Y'] = ALPHA, ['Z'] = ALPHA,
+        ['a'] = ALPHA, ['b'] = ALPHA, ['c'] = ALPHA, ['d'] = ALPHA, ['e'] = ALPHA, ['f'] = ALPHA,
+        ['g'] = ALPHA, ['h'] = ALPHA, ['i'] = ALPHA, ['j'] = ALPHA, ['k'] = ALPHA, ['l'] = ALPHA,
+        ['m'] = ALPHA, ['n'] = ALPHA, ['o'] = ALPHA, ['p'] = ALPHA, ['q'] = ALPHA, ['r'] = ALPHA,
+        ['s'] = ALPHA, ['t'] = ALPHA, ['u'] = ALPHA, ['v'] = ALPHA, ['w'] = ALPHA, ['x'] = ALPHA,
+        ['y'] = ALPHA, ['z'] = ALPHA,
+        ['_'] = CHAR_IDENT,
+};
+
+#undef DIGIT
+#undef ALPHA
+
+static inline size_t scan_scalar(const char *source, size_t pos, size_t len, int cls) {
+    while (pos < len && char_is(source[pos], cls)) {
+        pos++;
+    }
+    return pos;
+}
+
+static size_t skip_whitespace_scalar(const char *source, size_t pos, size_t len) {
+    return scan_scalar(source, pos, len, CHAR_SPACE);
+}
+
+static size_t skip_identifier_scalar(const char *source, size_t pos, size_t len) {
+    return scan_scalar(source, pos, len, CHAR_IDENT);
+}
+
+static size_t skip_digits_scalar(const char *source, size_t pos, size_t len) {
+    return scan_scalar(source, pos, len, CHAR_DIGIT);
+}
+
+static const ScanKernels scan_kernels_scalar_ = {
+        .name = "scalar",
+        .skip_whitespace = skip_whitespace_scalar,
+        .skip_identifier = skip_identifier_scalar,
+        .skip_digits = skip_digits_scalar,
+};
+
+const ScanKernels *scan_kernels_scalar(void) {
+    return &scan_kernels_scalar_;
+}
+
+#ifdef SCAN_X86
+
+// The vector kernels compute a per-byte "in class" mask over a block and stop
+// at the first clear bit. Bytes >= 0x80 compare as negative, so the signed
+// range checks below never treat them as ASCII class members. Most runs are
+// short, so the first byte is checked before paying for a vector load, and
+// the last partial block falls back to the scalar loop.
+#define SCAN_KERNEL(__name, __attr, __vec, __width, __full, __load, __mask, __cls) \
+    __attr static size_t __name(const char *source, size_t pos, size_t len) { \
+        if (pos >= len || !char_is(source[pos], (__cls))) { \
+            return pos; \
+        } \
+        for (; pos + (__width) <= len; pos += (__width)) { \
+            uint32_t outside = (uint32_t) __mask(__load((const __vec *) (source + pos))) ^ (__full); \
+            if (outside != 0) { \
+                return pos + (size_t) __builtin_ctz(outside); \
+            } \
+        } \
+        return scan_scalar(source, pos, len, (__cls)); \
+    }
+
+#ifdef __SSE2__
+
+static inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char) (lo - 1))),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8((char) (hi + 1))));
+}
+
+static inline int whitespace_mask_sse2(__m128i v) {
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return _mm_movemask_epi8(_mm_or_si128(space, sse2_in_range(v, '\t', '\r')));
+}
+
+static inline int identifier_mask_sse2(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i ident = _mm_or_si128(sse2_in_range(lower, 'a', 'z'), sse2_in_range(v, '0', '9'));
+    ident = _mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    return _mm_movemask_epi8(ident);
+}
+
+static inline int digits_mask_sse2(__m128i v) {
+    return _mm_movemask_epi8(sse2_in_range(v, '0', '9'));
+}
+
+SCAN_KERNEL(skip_whitespace_sse2, , __m128i, 16, 0xffff, _mm_loadu_si128, whitespace_mask_sse2, CHAR_SPACE)
+SCAN_KERNEL(skip_identifier_sse2, , __m128i, 16, 0xffff, _mm_loadu_si128, identifier_mask_sse2, CHAR_IDENT)
+SCAN_KERNEL(skip_digits_sse2, , __m128i, 16, 0xffff, _mm_loadu_si128, digits_mask_sse2, CHAR_DIGIT)
+
+static const ScanKernels scan_kernels_sse2_ = {
+        .name = "sse2",
+        .skip_whitespace = skip_whitespace_sse2,
+        .skip_identifier = skip_identifier_sse2,
+        .skip_digits = skip_digits_sse2,
+};
+
+#endif
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_in_range(__m256i v, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((char) (lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (hi + 1)), v));
+}
+
+AVX2 static inline int whitespace_mask_avx2(__m256i v) {
+    __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    return _mm256_movemask_epi8(_mm256_or_si256(space, avx2_in_range(v, '\t', '\r')));
+}
+
+AVX2 static inline int identifier_mask_avx2(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i ident = _mm256_or_si256(avx2_in_range(lower, 'a', 'z'), avx2_in_range(v, '0', '9'));
+    ident = _mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    return _mm256_movemask_epi8(ident);
+}
+
+AVX2 static inline int digits_mask_avx2(__m256i v) {
+    return _mm256_movemask_epi8(avx2_in_range(v, '0', '9'));
+}
+
+SCAN_KERNEL(skip_whitespace_avx2, AVX2, __m256i, 32, 0xffffffff, _mm256_loadu_si256, whitespace_mask_avx2, CHAR_SPACE)
+SCAN_KERNEL(skip_identifier_avx2, AVX2, __m256i, 32, 0xffffffff, _mm256_loadu_si256, identifier_mask_avx2, CHAR_IDENT)
+SCAN_KERNEL(skip_digits_avx2, AVX2, __m256i, 32, 0xffffffff, _mm256_loadu_si256, digits_mask_avx2, CHAR_DIGIT)
+
+static const ScanKernels scan_kernels_avx2_ = {
+        .name = "avx2",
+        .skip_whitespace = skip_whitespace_avx2,
+        .skip_identifier = skip_identifier_avx2,
+        .skip_digits = skip_digits_avx2,
+};
+
+#endif
+
+const ScanKernels *scan_kernels_sse2(void) {
+#if defined(SCAN_X86) && defined(__SSE2__)
+    return &scan_kernels_sse2_;
+#else
+    return NULL;
+#endif
+}
+
+const ScanKernels *scan_kernels_avx2(void) {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &scan_kernels_avx2_;
+    }
+#endif
+    return NULL;
+}
+
+const ScanKernels *scan_kernels_best(void) {
+    if (scan_kernels_avx2() != NULL) {
+        return scan_kernels_avx2();
+    }
+    if (scan_kernels_sse2() != NULL) {
+        return scan_kernels_sse2();
+    }
+    return &scan_kernels_scalar_;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+enum {
+    CHAR_SPACE = 1 << 0,
+    CHAR_DIGIT = 1 << 1,
+    CHAR_IDENT_START = 1 << 2,
+    CHAR_IDENT = 1 << 3,
+};
+
+extern const unsigned char char_class[256];
+
+static inline bool char_is(char c, int cls) {
+    return (char_class[(unsigned char) c] & cls) != 0;
+}
+
+// Each kernel returns the first position at or after `pos` (and before
+// `len`) whose character is not in the kernel's class, or `len`. Kernels
+// never read at or past `len`.
+typedef size_t (*ScanKernel)(const char *source, size_t pos, size_t len);
+
+typedef struct {
+    const char *name;
+    ScanKernel skip_whitespace;
+    ScanKernel skip_identifier;
+    ScanKernel skip_digits;
+} ScanKernels;
+
+const ScanKernels *scan_kernels_scalar(void);
+
+// The vector kernels, or NULL when the build or the running CPU lacks
+// them.
+const ScanKernels *scan_kernels_sse2(void);
+const ScanKernels *scan_kernels_avx2(void);
+
+// The widest kernels the running CPU supports.
+const ScanKernels *scan_kernels_best(void);
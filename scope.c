@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scope.h"
+#include "vendor/stretchy_buffer.h"
+
+#define SCOPE_INITIAL_SLOTS 16
+#define SCOPE_EMPTY (-1)
+
+static size_t scope_hash(int name, size_t mask) {
+    // Name ids are dense, so spread them with a Fibonacci multiplier.
+    return (size_t) (((uint64_t) (uint32_t) name * 0x9e3779b97f4a7c15) >> 32) & mask;
+}
+
+static int *scope_alloc_slots(size_t slot_count) {
+    int *slots = malloc(sizeof(int) * slot_count);
+    memset(slots, 0xff, sizeof(int) * slot_count);
+    return slots;
+}
+
+Scope *scope_create(ScopeKind kind, Scope *parent) {
+    Scope *scope = malloc(sizeof(Scope));
+    scope->kind = kind;
+    scope->parent = parent;
+    scope->symbols = NULL;
+    scope->slot_count = SCOPE_INITIAL_SLOTS;
+    scope->slots = scope_alloc_slots(scope->slot_count);
+    return scope;
+}
+
+void scope_destroy(Scope *scope) {
+    for (int i = 0; i < sb_count(scope->symbols); i++) {
+        sb_free(scope->symbols[i].decls);
+    }
+    sb_free(scope->symbols);
+    free(scope->slots);
+    free(scope);
+}
+
+// Returns the slot holding `name`, or the empty slot where it belongs.
+static size_t scope_find_slot(Scope *scope, int name) {
+    size_t mask = scope->slot_count - 1;
+    size_t i = scope_hash(name, mask);
+    while (scope->slots[i] != SCOPE_EMPTY && scope->symbols[scope->slots[i]].name != name) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void scope_grow(Scope *scope) {
+    free(scope->slots);
+    scope->slot_count *= 2;
+    scope->slots = scope_alloc_slots(scope->slot_count);
+    for (int i = 0; i < sb_count(scope->symbols); i++) {
+        scope->slots[scope_find_slot(scope, scope->symbols[i].name)] = i;
+    }
+}
+
+Symbol *scope_lookup_local(Scope *scope, int name) {
+    int index = scope->slots[scope_find_slot(scope, name)];
+    return index == SCOPE_EMPTY ? NULL : &scope->symbols[index];
+}
+
+Symbol *scope_lookup(Scope *scope, int name) {
+    for (; scope != NULL; scope = scope->parent) {
+        Symbol *symbol = scope_lookup_local(scope, name);
+        if (symbol != NULL) {
+            return symbol;
+        }
+    }
+    return NULL;
+}
+
+// Returns the symbol for `name` in this scope, creating it if needed. The
+// pointer is only valid until the next declaration in the same scope.
+Symbol *scope_declare(Scope *scope, int name) {
+    size_t slot = scope_find_slot(scope, name);
+    if (scope->slots[slot] != SCOPE_EMPTY) {
+        return &scope->symbols[scope->slots[slot]];
+    }
+
+    int index = sb_count(scope->symbols);
+    Symbol symbol = {.name = name, .value_decl = AST_NONE, .type_decl = AST_NONE, .decls = NULL};
+    sb_push(scope->symbols, symbol);
+    scope->slots[slot] = index;
+
+    // Keep the load factor at or below 1/2.
+    if ((size_t) sb_count(scope->symbols) * 2 > scope->slot_count) {
+        scope_grow(scope);
+    }
+    return &scope->symbols[index];
+}
+
+// Removes `name` from this scope if present. Like scope_declare, this
+// invalidates symbol pointers into the scope.
+void scope_remove(Scope *scope, int name) {
+    size_t mask = scope->slot_count - 1;
+    size_t hole = scope_find_slot(scope, name);
+    int index = scope->slots[hole];
+    if (index == SCOPE_EMPTY) {
+        return;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole unless that would move them before their home slot.
+    scope->slots[hole] = SCOPE_EMPTY;
+    for (size_t i = (hole + 1) & mask; scope->slots[i] != SCOPE_EMPTY; i = (i + 1) & mask) {
+        size_t home = scope_hash(scope->symbols[scope->slots[i]].name, mask);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            scope->slots[hole] = scope->slots[i];
+            scope->slots[i] = SCOPE_EMPTY;
+            hole = i;
+        }
+    }
+
+    // Fill the gap in the symbol array with the last symbol.
+    sb_free(scope->symbols[index].decls);
+    int last = sb_count(scope->symbols) - 1;
+    if (index != last) {
+        scope->symbols[index] = scope->symbols[last];
+        scope->slots[scope_find_slot(scope, scope->symbols[index].name)] = index;
+    }
+    stb__sbn(scope->symbols)--;
+}
+
+int scope_symbol_count(Scope *scope) {
+    return sb_count(scope->symbols);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "ast.h"
+
+typedef struct {
+    int name;
+    // The first let and the first type alias in source order, or AST_NONE.
+    NodeId value_decl;
+    NodeId type_decl;
+    // Every declaration, in source order.
+    NodeId *decls;
+} Symbol;
+
+typedef enum {
+    SCOPE_MODULE,
+    SCOPE_FUNCTION,
+    SCOPE_BLOCK,
+} ScopeKind;
+
+typedef struct Scope_ Scope;
+
+// Symbols declared directly in one scope, keyed by interned name id.
+// Lookups that miss fall through to the parent scope.
+struct Scope_ {
+    ScopeKind kind;
+    Scope *parent;
+    Symbol *symbols;
+    int *slots;
+    size_t slot_count;
+};
+
+Scope *scope_create(ScopeKind kind, Scope *parent);
+
+void scope_destroy(Scope *scope);
+
+Symbol *scope_lookup_local(Scope *scope, int name);
+
+Symbol *scope_lookup(Scope *scope, int name);
+
+Symbol *scope_declare(Scope *scope, int name);
+
+void scope_remove(Scope *scope, int name);
+
+int scope_symbol_count(Scope *scope);
@@ -0,0 +1,497 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "bind.h"
+#include "check.h"
+#include "edit.h"
+#include "json.h"
+#include "lexer.h"
+#include "parser.h"
+#include "scan.h"
+#include "serve.h"
+#include "vendor/stretchy_buffer.h"
+
+#define JSONRPC_PARSE_ERROR (-32700)
+#define JSONRPC_INVALID_REQUEST (-32600)
+#define JSONRPC_METHOD_NOT_FOUND (-32601)
+
+typedef struct {
+    char *uri;
+    // The text the document was opened with. The module copies it on the
+    // first edit.
+    char *text;
+    Module *mod;
+} Document;
+
+typedef struct {
+    FILE *in;
+    FILE *out;
+    Document *documents;
+    bool shutdown;
+} Server;
+
+// Builds one outgoing message; serve_send frames and writes it.
+typedef struct {
+    FILE *out;
+    char *body;
+    size_t len;
+} Message;
+
+static Module *document_parse(const char *text, size_t len) {
+    Module *mod = module_create(text, len);
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    // Bind and check even with syntax errors, so definitions and type
+    // errors keep working mid-edit.
+    module_bind(mod);
+    module_check(mod);
+    return mod;
+}
+
+static void document_set_text(Document *doc, const char *text, size_t len) {
+    if (doc->mod != NULL) {
+        module_destroy(doc->mod);
+    }
+    free(doc->text);
+    doc->text = malloc(len > 0 ? len : 1);
+    memcpy(doc->text, text, len);
+    doc->mod = document_parse(doc->text, len);
+}
+
+static Document *server_find_document(Server *server, const char *uri) {
+    for (int i = 0; i < sb_count(server->documents); i++) {
+        if (strcmp(server->documents[i].uri, uri) == 0) {
+            return &server->documents[i];
+        }
+    }
+    return NULL;
+}
+
+static Document *server_document_param(Server *server, const JsonValue *params) {
+    size_t len;
+    const char *uri = json_get_string(json_get(json_get(params, "textDocument"), "uri"), &len);
+    return uri != NULL ? server_find_document(server, uri) : NULL;
+}
+
+// Converts an LSP position to a source offset, clamping to the end of the
+// line and of the source.
+static size_t document_offset(const Module *mod, const JsonValue *position) {
+    double line;
+    double character;
+    if (!json_get_number(json_get(position, "line"), &line)
+        || !json_get_number(json_get(position, "character"), &character)) {
+        return 0;
+    }
+    int lines = sb_count(mod->line_starts);
+    if (line < 0 || character < 0) {
+        return 0;
+    }
+    if (line >= lines) {
+        return mod->source_len;
+    }
+    size_t start = mod->line_starts[(int) line];
+    size_t end = (int) line + 1 < lines ? mod->line_starts[(int) line + 1] - 1 : mod->source_len;
+    return character < (double) (end - start) ? start + (size_t) character : end;
+}
+
+static void message_begin(Message *msg) {
+    msg->out = open_memstream(&msg->body, &msg->len);
+    fprintf(msg->out, "{\"jsonrpc\":\"2.0\"");
+}
+
+static void message_write_id(Message *msg, const JsonValue *id) {
+    fprintf(msg->out, ",\"id\":");
+    if (id != NULL && id->kind == JSON_STRING) {
+        json_write_string(msg->out, id->string.text, id->string.len);
+    } else if (id != NULL && id->kind == JSON_NUMBER) {
+        fprintf(msg->out, "%.17g", id->number);
+    } else {
+        fprintf(msg->out, "null");
+    }
+}
+
+static void serve_send(Server *server, Message *msg) {
+    fprintf(msg->out, "}");
+    fclose(msg->out);
+    fprintf(server->out, "Content-Length: %zu\r\n\r\n", msg->len);
+    fwrite(msg->body, 1, msg->len, server->out);
+    fflush(server->out);
+    free(msg->body);
+}
+
+static void serve_error(Server *server, const JsonValue *id, int code, const char *message) {
+    Message msg;
+    message_begin(&msg);
+    message_write_id(&msg, id);
+    fprintf(msg.out, ",\"error\":{\"code\":%d,\"message\":", code);
+    json_write_string(msg.out, message, strlen(message));
+    fprintf(msg.out, "}");
+    serve_send(server, &msg);
+}
+
+static void write_position(FILE *out, const Module *mod, size_t pos) {
+    LineCol at = line_starts_lookup(mod->line_starts, pos);
+    fprintf(out, "{\"line\":%zu,\"character\":%zu}", at.line - 1, at.column - 1);
+}
+
+static void write_range(FILE *out, const Module *mod, size_t start, size_t end) {
+    fprintf(out, "{\"start\":");
+    write_position(out, mod, start);
+    fprintf(out, ",\"end\":");
+    write_position(out, mod, end);
+    fprintf(out, "}");
+}
+
+// Ranges only have a start in the AST and diagnostics; extend them over the
+// word there, or a single character.
+static size_t word_end(const Module *mod, size_t pos) {
+    size_t end = pos;
+    while (end < mod->source_len && char_is(mod->source[end], CHAR_IDENT)) {
+        end++;
+    }
+    if (end == pos && end < mod->source_len && mod->source[end] != '\n') {
+        end++;
+    }
+    return end;
+}
+
+static void write_diagnostics(FILE *out, const Module *mod) {
+    Diagnostic *lists[] = {mod->diagnostics, mod->bind_diagnostics, mod->check_diagnostics};
+    bool first = true;
+    fprintf(out, "[");
+    for (int list = 0; list < 3; list++) {
+        for (int i = 0; i < sb_count(lists[list]); i++) {
+            Diagnostic *diagnostic = &lists[list][i];
+            size_t pos = diagnostic->location.pos;
+            fprintf(out, "%s{\"range\":", first ? "" : ",");
+            write_range(out, mod, pos, word_end(mod, pos));
+            fprintf(out,
+                    ",\"severity\":1,\"code\":\"%s\",\"source\":\"ts\",\"message\":",
+                    diagnostic_kind_name(diagnostic->kind));
+            json_write_string(out, diagnostic->message, strlen(diagnostic->message));
+            fprintf(out, "}");
+            first = false;
+        }
+    }
+    fprintf(out, "]");
+}
+
+static void serve_publish_diagnostics(Server *server, const char *uri, const Module *mod) {
+    Message msg;
+    message_begin(&msg);
+    fprintf(msg.out, ",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    json_write_string(msg.out, uri, strlen(uri));
+    fprintf(msg.out, ",\"diagnostics\":");
+    if (mod != NULL) {
+        write_diagnostics(msg.out, mod);
+    } else {
+        fprintf(msg.out, "[]");
+    }
+    fprintf(msg.out, "}");
+    serve_send(server, &msg);
+}
+
+static void serve_did_open(Server *server, const JsonValue *params) {
+    const JsonValue *text_document = json_get(params, "textDocument");
+    size_t uri_len;
+    size_t text_len;
+    const char *uri = json_get_string(json_get(text_document, "uri"), &uri_len);
+    const char *text = json_get_string(json_get(text_document, "text"), &text_len);
+    if (uri == NULL || text == NULL || text_len > LEXER_MAX_SOURCE_LEN) {
+        return;
+    }
+
+    Document *doc = server_find_document(server, uri);
+    if (doc == NULL) {
+        Document fresh = {.uri = strdup(uri), .text = NULL, .mod = NULL};
+        sb_push(server->documents, fresh);
+        doc = &sb_last(server->documents);
+    }
+    document_set_text(doc, text, text_len);
+    serve_publish_diagnostics(server, doc->uri, doc->mod);
+}
+
+static void serve_did_change(Server *server, const JsonValue *params) {
+    Document *doc = server_document_param(server, params);
+    const JsonValue *changes = json_get(params, "contentChanges");
+    if (doc == NULL || changes == NULL || changes->kind != JSON_ARRAY) {
+        return;
+    }
+
+    for (size_t i = 0; i < changes->array.count; i++) {
+        const JsonValue *change = &changes->array.items[i];
+        size_t text_len;
+        const char *text = json_get_string(json_get(change, "text"), &text_len);
+        if (text == NULL) {
+            continue;
+        }
+        const JsonValue *range = json_get(change, "range");
+        if (range == NULL) {
+            if (text_len <= LEXER_MAX_SOURCE_LEN) {
+                document_set_text(doc, text, text_len);
+            }
+            continue;
+        }
+
+        size_t start = document_offset(doc->mod, json_get(range, "start"));
+        size_t end = document_offset(doc->mod, json_get(range, "end"));
+        if (end < start) {
+            size_t tmp = start;
+            start = end;
+            end = tmp;
+        }
+        if (doc->mod->source_len - (end - start) + text_len > LEXER_MAX_SOURCE_LEN) {
+            continue;
+        }
+        module_edit(doc->mod, start, end - start, text, text_len);
+    }
+    // Aliases can be used before they are declared, so any edit can change
+    // what a type resolves to.
+    module_check(doc->mod);
+    serve_publish_diagnostics(server, doc->uri, doc->mod);
+}
+
+static void serve_did_close(Server *server, const JsonValue *params) {
+    Document *doc = server_document_param(server, params);
+    if (doc == NULL) {
+        return;
+    }
+    serve_publish_diagnostics(server, doc->uri, NULL);
+    module_destroy(doc->mod);
+    free(doc->text);
+    free(doc->uri);
+    *doc = sb_last(server->documents);
+    stb__sbn(server->documents)--;
+}
+
+static void serve_initialize(Server *server, const JsonValue *id) {
+    Message msg;
+    message_begin(&msg);
+    message_write_id(&msg, id);
+    fprintf(msg.out,
+            ",\"result\":{\"capabilities\":{"
+            "\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+            "\"definitionProvider\":true,"
+            "\"referencesProvider\":true,"
+            "\"diagnosticProvider\":{\"interFileDependencies\":false,\"workspaceDiagnostics\":false}"
+            "},\"serverInfo\":{\"name\":\"ts\"}}");
+    serve_send(server, &msg);
+}
+
+static void serve_diagnostic(Server *server, const JsonValue *id, const JsonValue *params) {
+    Document *doc = server_document_param(server, params);
+    Message msg;
+    message_begin(&msg);
+    message_write_id(&msg, id);
+    fprintf(msg.out, ",\"result\":{\"kind\":\"full\",\"items\":");
+    if (doc != NULL) {
+        write_diagnostics(msg.out, doc->mod);
+    } else {
+        fprintf(msg.out, "[]");
+    }
+    fprintf(msg.out, "}");
+    serve_send(server, &msg);
+}
+
+// Returns the name id of the identifier at `pos`, or -1.
+static int document_name_at(const Module *mod, size_t pos) {
+    size_t start = pos;
+    size_t end = pos;
+    while (start > 0 && char_is(mod->source[start - 1], CHAR_IDENT)) {
+        start--;
+    }
+    while (end < mod->source_len && char_is(mod->source[end], CHAR_IDENT)) {
+        end++;
+    }
+    if (start == end || !char_is(mod->source[start], CHAR_IDENT_START)) {
+        return -1;
+    }
+    return interner_lookup(mod->names, mod->source + start, end - start);
+}
+
+// Returns the declaration of the top-level symbol named by the identifier
+// at `pos`, or AST_NONE.
+static NodeId document_definition(const Module *mod, size_t pos) {
+    int name = document_name_at(mod, pos);
+    if (name < 0) {
+        return AST_NONE;
+    }
+    Symbol *symbol = scope_lookup(mod->locals, name);
+    return symbol != NULL && sb_count(symbol->decls) > 0 ? symbol->decls[0] : AST_NONE;
+}
+
+// Declarations are located at their keyword; their name is the next word.
+static size_t decl_name_pos(const Module *mod, NodeId decl) {
+    size_t pos = ast_location(&mod->ast, decl).pos;
+    while (pos < mod->source_len && char_is(mod->source[pos], CHAR_IDENT)) {
+        pos++;
+    }
+    while (pos < mod->source_len && char_is(mod->source[pos], CHAR_SPACE)) {
+        pos++;
+    }
+    return pos;
+}
+
+static void write_location(FILE *out, const Document *doc, size_t pos) {
+    fprintf(out, "{\"uri\":");
+    json_write_string(out, doc->uri, strlen(doc->uri));
+    fprintf(out, ",\"range\":");
+    write_range(out, doc->mod, pos, word_end(doc->mod, pos));
+    fprintf(out, "}");
+}
+
+static void serve_definition(Server *server, const JsonValue *id, const JsonValue *params) {
+    Document *doc = server_document_param(server, params);
+    NodeId decl = AST_NONE;
+    if (doc != NULL) {
+        decl = document_definition(doc->mod, document_offset(doc->mod, json_get(params, "position")));
+    }
+
+    Message msg;
+    message_begin(&msg);
+    message_write_id(&msg, id);
+    fprintf(msg.out, ",\"result\":");
+    if (decl == AST_NONE) {
+        fprintf(msg.out, "null");
+    } else {
+        write_location(msg.out, doc, decl_name_pos(doc->mod, decl));
+    }
+    serve_send(server, &msg);
+}
+
+static void serve_references(Server *server, const JsonValue *id, const JsonValue *params) {
+    Document *doc = server_document_param(server, params);
+    Message msg;
+    message_begin(&msg);
+    message_write_id(&msg, id);
+    fprintf(msg.out, ",\"result\":[");
+    int name = doc != NULL ? document_name_at(doc->mod, document_offset(doc->mod, json_get(params, "position"))) : -1;
+    if (name >= 0) {
+        Module *mod = doc->mod;
+        bool first = true;
+        const JsonValue *include = json_get(json_get(params, "context"), "includeDeclaration");
+        Symbol *symbol = scope_lookup(mod->locals, name);
+        if (symbol != NULL && include != NULL && include->kind == JSON_BOOL && include->boolean) {
+            for (int i = 0; i < sb_count(symbol->decls); i++) {
+                fprintf(msg.out, "%s", first ? "" : ",");
+                write_location(msg.out, doc, decl_name_pos(mod, symbol->decls[i]));
+                first = false;
+            }
+        }
+        RefCursor cursor = ref_index_find(module_references(mod), name);
+        size_t pos;
+        while (ref_cursor_next(&cursor, &pos)) {
+            fprintf(msg.out, "%s", first ? "" : ",");
+            write_location(msg.out, doc, pos);
+            first = false;
+        }
+    }
+    fprintf(msg.out, "]");
+    serve_send(server, &msg);
+}
+
+// Handles one message. Returns false once the client has sent `exit`.
+static bool serve_dispatch(Server *server, const JsonValue *request) {
+    size_t len;
+    const char *method = json_get_string(json_get(request, "method"), &len);
+    const JsonValue *id = json_get(request, "id");
+    const JsonValue *params = json_get(request, "params");
+    if (method == NULL) {
+        // Responses to requests we never send, or garbage.
+        if (id != NULL && json_get(request, "result") == NULL && json_get(request, "error") == NULL) {
+            serve_error(server, id, JSONRPC_INVALID_REQUEST, "missing method");
+        }
+        return true;
+    }
+
+    if (strcmp(method, "initialize") == 0) {
+        serve_initialize(server, id);
+    } else if (strcmp(method, "shutdown") == 0) {
+        server->shutdown = true;
+        Message msg;
+        message_begin(&msg);
+        message_write_id(&msg, id);
+        fprintf(msg.out, ",\"result\":null");
+        serve_send(server, &msg);
+    } else if (strcmp(method, "exit") == 0) {
+        return false;
+    } else if (strcmp(method, "textDocument/didOpen") == 0) {
+        serve_did_open(server, params);
+    } else if (strcmp(method, "textDocument/didChange") == 0) {
+        serve_did_change(server, params);
+    } else if (strcmp(method, "textDocument/didClose") == 0) {
+        serve_did_close(server, params);
+    } else if (strcmp(method, "textDocument/diagnostic") == 0) {
+        serve_diagnostic(server, id, params);
+    } else if (strcmp(method, "textDocument/definition") == 0) {
+        serve_definition(server, id, params);
+    } else if (strcmp(method, "textDocument/references") == 0) {
+        serve_references(server, id, params);
+    } else if (id != NULL) {
+        serve_error(server, id, JSONRPC_METHOD_NOT_FOUND, method);
+    }
+    // Other notifications ($/cancelRequest, initialized, ...) need no reply.
+    return true;
+}
+
+// Reads the next message body, or returns NULL at end of input.
+static char *serve_read_message(Server *server, size_t *len) {
+    char line[256];
+    size_t content_length = SIZE_MAX;
+    while (true) {
+        if (fgets(line, sizeof(line), server->in) == NULL) {
+            return NULL;
+        }
+        if (strcmp(line, "\r\n") == 0 || strcmp(line, "\n") == 0) {
+            if (content_length != SIZE_MAX) {
+                break;
+            }
+        } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_length = strtoull(line + 15, NULL, 10);
+        }
+    }
+
+    char *body = malloc(content_length > 0 ? content_length : 1);
+    if (body == NULL || fread(body, 1, content_length, server->in) != content_length) {
+        free(body);
+        return NULL;
+    }
+    *len = content_length;
+    return body;
+}
+
+int serve_run(FILE *in, FILE *out) {
+    Server server = {.in = in, .out = out, .documents = NULL, .shutdown = false};
+    bool running = true;
+    while (running) {
+        size_t len;
+        char *body = serve_read_message(&server, &len);
+        if (body == NULL) {
+            break;
+        }
+        Arena *arena = arena_create();
+        JsonValue *request = json_parse(arena, body, len);
+        if (request == NULL) {
+            serve_error(&server, NULL, JSONRPC_PARSE_ERROR, "invalid JSON");
+        } else {
+            running = serve_dispatch(&server, request);
+        }
+        arena_destroy(arena);
+        free(body);
+    }
+
+    for (int i = 0; i < sb_count(server.documents); i++) {
+        module_destroy(server.documents[i].mod);
+        free(server.documents[i].text);
+        free(server.documents[i].uri);
+    }
+    sb_free(server.documents);
+    // LSP: exit without a prior shutdown is an error.
+    return server.shutdown ? 0 : 1;
+}
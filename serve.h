@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdio.h>
+
+// Runs a language server over `in` and `out`: JSON-RPC 2.0 messages with
+// LSP's Content-Length framing. Open documents stay parsed and bound
+// between requests, and changes are applied with module_edit. Supports
+// didOpen/didChange/didClose, pushed and pulled diagnostics, and
+// go-to-definition for top-level declarations.
+//
+// Positions are taken to count bytes rather than UTF-16 code units, which
+// only matters on lines with non-ASCII text. Returns the exit status once
+// the client sends `exit` or closes `in`.
+int serve_run(FILE *in, FILE *out);
@@ -0,0 +1,78 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.h"
+
+static bool source_file_read(SourceFile *file, int fd) {
+    size_t cap = 64 * 1024;
+    char *data = malloc(cap);
+    size_t len = 0;
+    while (true) {
+        if (len == cap) {
+            cap *= 2;
+            data = realloc(data, cap);
+        }
+        ssize_t n = read(fd, data + len, cap - len);
+        if (n < 0) {
+            free(data);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += (size_t) n;
+    }
+
+    file->data = data;
+    file->len = len;
+    file->mapped = false;
+    return true;
+}
+
+bool source_file_open(SourceFile *file, const char *path) {
+    file->path = path;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            file->data = data;
+            file->len = (size_t) st.st_size;
+            file->mapped = true;
+            return true;
+        }
+    }
+
+    bool ok = source_file_read(file, fd);
+    close(fd);
+    return ok;
+}
+
+void source_file_close(SourceFile *file) {
+    if (file->mapped) {
+        munmap((void *) file->data, file->len);
+    } else {
+        free((void *) file->data);
+    }
+    file->data = NULL;
+    file->len = 0;
+}
+
+void source_file_release(const SourceFile *file, size_t end) {
+    if (!file->mapped) {
+        return;
+    }
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t len = end / page * page;
+    if (len > 0) {
+        madvise((void *) file->data, len, MADV_DONTNEED);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A read-only view of a file's contents. Regular files are memory mapped;
+// anything that can't be mapped (pipes, empty files) is read into memory.
+// The contents are not NUL-terminated.
+typedef struct {
+    const char *path;
+    const char *data;
+    size_t len;
+    bool mapped;
+} SourceFile;
+
+bool source_file_open(SourceFile *file, const char *path);
+
+void source_file_close(SourceFile *file);
+
+// Lets the kernel drop the mapped pages before `end` from memory; they are
+// read back from the file if touched again. Does nothing for files that
+// were read into memory.
+void source_file_release(const SourceFile *file, size_t end);
@@ -0,0 +1,31 @@
+#include <string.h>
+
+#include "span.h"
+
+Span span_create(size_t from, size_t to) {
+    Span span = {.offset = from, .len = to - from};
+    return span;
+}
+
+const char *span_text(const char *source, Span span) {
+    return source + span.offset;
+}
+
+bool span_eq(const char *source, Span a, Span b) {
+    return a.len == b.len && memcmp(source + a.offset, source + b.offset, a.len) == 0;
+}
+
+bool span_eq_str(const char *source, Span span, const char *str) {
+    return strlen(str) == span.len && memcmp(source + span.offset, str, span.len) == 0;
+}
+
+// FNV-1a; identifiers are short, so a byte-at-a-time hash is fine here.
+uint64_t span_hash(const char *source, Span span) {
+    uint64_t hash = 0xcbf29ce484222325;
+    const unsigned char *text = (const unsigned char *) source + span.offset;
+    for (size_t i = 0; i < span.len; i++) {
+        hash ^= text[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A view of `len` bytes starting at `offset` in some source buffer. Spans
+// don't own or point at their text; the buffer is passed alongside them.
+typedef struct {
+    size_t offset;
+    size_t len;
+} Span;
+
+Span span_create(size_t from, size_t to);
+
+const char *span_text(const char *source, Span span);
+
+bool span_eq(const char *source, Span a, Span b);
+
+bool span_eq_str(const char *source, Span span, const char *str);
+
+uint64_t span_hash(const char *source, Span span);
@@ -0,0 +1,160 @@
+#include <string.h>
+
+#include "check.h"
+#include "stream.h"
+#include "vendor/stretchy_buffer.h"
+
+// How far the parser gets between releases of the source pages behind it.
+#define STREAM_RELEASE_BYTES (16 * 1024 * 1024)
+
+typedef struct {
+    Module *mod;
+    Lexer *lexer;
+    const SourceFile *file;
+    // Everything before the mark is a kept declaration record.
+    AstMark mark;
+    // Name ids of the builtin types, or -1 until they appear.
+    int builtins[TYPE_BUILTIN_COUNT];
+    // mod->line_starts only holds the lines from the last statement on;
+    // this is the number of the first.
+    size_t window_line;
+    // Syntax errors that have already been given a line mark.
+    int diagnostics_marked;
+    size_t released;
+    StreamResult result;
+} Stream;
+
+// Whether `name` already resolves to something: a builtin or an alias.
+static bool stream_type_declared(Stream *stream, int name) {
+    Module *mod = stream->mod;
+    for (int i = 0; i < TYPE_BUILTIN_COUNT; i++) {
+        if (stream->builtins[i] < 0) {
+            const char *builtin = type_name((Type) (TYPE_NUMBER + i));
+            stream->builtins[i] = interner_lookup(mod->names, builtin, strlen(builtin));
+        }
+        if (stream->builtins[i] == name) {
+            return true;
+        }
+    }
+    Symbol *symbol = scope_lookup(mod->locals, name);
+    return symbol != NULL && symbol->type_decl != AST_NONE;
+}
+
+// Marks the line `pos` is on, which must be in the window.
+static void stream_mark_line(Stream *stream, size_t pos) {
+    Module *mod = stream->mod;
+    LineCol at = line_starts_lookup(mod->line_starts, pos);
+    LineMark mark = {.start = (uint32_t) (pos - (at.column - 1)), .line = (uint32_t) (stream->window_line + at.line - 1)};
+    if (sb_last(mod->line_marks).start < mark.start) {
+        sb_push(mod->line_marks, mark);
+    }
+}
+
+static void stream_mark_diagnostics(Stream *stream) {
+    Module *mod = stream->mod;
+    for (; stream->diagnostics_marked < sb_count(mod->diagnostics); stream->diagnostics_marked++) {
+        stream_mark_line(stream, mod->diagnostics[stream->diagnostics_marked].location.pos);
+    }
+}
+
+static void stream_statement(void *arg, NodeId stmt) {
+    Stream *stream = arg;
+    Module *mod = stream->mod;
+    Ast *ast = &mod->ast;
+    stream->result.statements++;
+
+    uint32_t *line_starts = stream->lexer->line_starts;
+    if (line_starts != NULL) {
+        line_starts_append(&mod->line_starts, line_starts);
+        stb__sbn(line_starts) = 0;
+    }
+    stream_mark_diagnostics(stream);
+
+    NodeKind kind = ast_kind(ast, stmt);
+    Location location = ast_location(ast, stmt);
+    bool keep = false;
+    bool first = false;
+    bool redeclared = false;
+    int name = -1;
+    int type_name = -1;
+    if (ast_is_decl(ast, stmt)) {
+        name = node_name(ast, stmt);
+        type_name = kind == NODE_DECL_LET ? decl_let_type_name(ast, stmt) : decl_type_alias_type_name(ast, stmt);
+        first = module_bind_first_of_kind(mod, stmt);
+        redeclared = !first;
+        if (redeclared) {
+            stream->result.bind_res = BIND_RESULT_CANNOT_REDECLARE;
+        }
+        keep = first || (kind == NODE_DECL_LET && type_name >= 0 && !stream_type_declared(stream, type_name));
+    }
+
+    ast_truncate(ast, stream->mark);
+    if (keep) {
+        NodeId record = kind == NODE_DECL_LET
+                        ? decl_let_create(ast, location, name, type_name, AST_NONE)
+                        : decl_type_alias_create(ast, location, name, type_name);
+        sb_push(mod->statements, record);
+        if (first) {
+            module_bind_stmt(mod, record);
+        }
+        stream->mark = ast_mark(ast);
+    }
+    // Redeclaration and type errors are reported at kept declarations or
+    // at the statement just bound.
+    if (keep || redeclared) {
+        stream_mark_line(stream, location.pos);
+    }
+
+    // Nothing before this statement needs a line number any more.
+    LineCol at = line_starts_lookup(mod->line_starts, location.pos);
+    int drop = (int) at.line - 1;
+    if (drop > 0) {
+        memmove(mod->line_starts, mod->line_starts + drop, sizeof(uint32_t) * (size_t) (sb_count(mod->line_starts) - drop));
+        stb__sbn(mod->line_starts) -= drop;
+        stream->window_line += (size_t) drop;
+    }
+
+    if (stream->file != NULL && location.pos - stream->released >= STREAM_RELEASE_BYTES) {
+        source_file_release(stream->file, location.pos);
+        stream->released = location.pos;
+    }
+}
+
+StreamResult module_parse_streaming(Module *mod, const SourceFile *file, Stats *stats, Trace *trace) {
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    // The other token modes buffer tokens ahead of the parser.
+    parser->token_mode = TOKEN_MODE_LAZY;
+    parser->stats = stats;
+    parser->trace = trace;
+
+    Stream stream = {
+            .mod = mod,
+            .lexer = lexer,
+            .file = file,
+            .mark = ast_mark(&mod->ast),
+            .window_line = 1,
+            .diagnostics_marked = 0,
+            .released = 0,
+            .result = {.parse_res = PARSE_RESULT_OK, .bind_res = BIND_RESULT_OK, .statements = 0},
+    };
+    for (int i = 0; i < TYPE_BUILTIN_COUNT; i++) {
+        stream.builtins[i] = -1;
+    }
+    parser->on_statement = stream_statement;
+    parser->on_statement_arg = &stream;
+
+    LineMark first_line = {.start = 0, .line = 1};
+    sb_push(mod->line_marks, first_line);
+
+    stream.result.parse_res = parser_parse(parser, mod);
+    // Nodes and errors of statements after the last one that parsed.
+    ast_truncate(&mod->ast, stream.mark);
+    stream_mark_diagnostics(&stream);
+    sb_free(mod->line_starts);
+    mod->line_starts = NULL;
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    mod->bound = true;
+    return stream.result;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "bind.h"
+#include "parser.h"
+#include "source.h"
+
+typedef struct {
+    ParseResult parse_res;
+    BindResult bind_res;
+    // Statements parsed, including the ones that were released.
+    size_t statements;
+} StreamResult;
+
+// Parses and binds `mod` one statement at a time, for inputs too large to
+// hold a whole AST. Each statement is bound as soon as it is parsed and
+// then dropped from the AST. Only compact declaration records are kept in
+// the AST and mod->statements:
+//   - the first declaration of each kind for each name, with the
+//     initializers of lets left out;
+//   - lets annotated with a type that isn't declared yet, so module_check
+//     can still report it if it never is.
+// Memory then grows with the number of distinct names rather than with the
+// size of the file. When `file` is mapped, the pages the parser has moved
+// past are released as it goes.
+//
+// The result is a bound module that can be checked. It records no uses, so
+// it has no references, and it can't be emitted or edited.
+StreamResult module_parse_streaming(Module *mod, const SourceFile *file, Stats *stats, Trace *trace);
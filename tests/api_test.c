@@ -0,0 +1,222 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/expect.h"
+#include "ts.h"
+
+// The embeddable API, used only through ts.h: the diagnostics and symbols
+// of each phase, and contexts working in parallel threads.
+
+#define API_TEST_THREADS 8
+#define API_TEST_THREAD_ROUNDS 20
+
+static const char source[] = "let a = 1;\n"
+                             "let = 2;\n"
+                             "let a = 3;\n"
+                             "type T = Missing;\n"
+                             "let b: T = a;\n"
+                             "type a = number;\n";
+
+static const char *const kind_names[] = {"syntax", "redeclaration", "type"};
+
+static int compare_symbols(const void *a, const void *b) {
+    return strcmp(((const TsSymbol *) a)->name, ((const TsSymbol *) b)->name);
+}
+
+// The module's diagnostics in order and its symbols by name, as text. Free
+// the result.
+static char *dump(const TsModule *mod) {
+    char *text;
+    size_t len;
+    FILE *out = open_memstream(&text, &len);
+    for (int i = 0; i < ts_diagnostic_count(mod); i++) {
+        TsDiagnostic diagnostic = ts_diagnostic(mod, i);
+        fprintf(out,
+                "%s @%zu %zu:%zu %s\n",
+                kind_names[diagnostic.kind],
+                diagnostic.offset,
+                diagnostic.line,
+                diagnostic.column,
+                diagnostic.message);
+    }
+
+    int count = ts_symbol_count(mod);
+    TsSymbol *symbols = malloc(sizeof(TsSymbol) * (size_t) (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        symbols[i] = ts_symbol(mod, i);
+    }
+    qsort(symbols, (size_t) count, sizeof(TsSymbol), compare_symbols);
+    for (int i = 0; i < count; i++) {
+        const TsSymbol *symbol = &symbols[i];
+        fprintf(out,
+                "symbol %.*s%s%s x%d @%zu %zu:%zu\n",
+                (int) symbol->name_len,
+                symbol->name,
+                symbol->is_value ? " value" : "",
+                symbol->is_type ? " type" : "",
+                symbol->declarations,
+                symbol->offset,
+                symbol->line,
+                symbol->column);
+    }
+    free(symbols);
+    fclose(out);
+    return text;
+}
+
+// Each phase adds its diagnostics after those of the phases before it.
+static void test_phases(void) {
+    TsContext *ctx = ts_context_create();
+    TsModule *mod = ts_parse(ctx, source, strlen(source));
+    EXPECT(mod != NULL, "parse failed");
+
+    char *parsed = dump(mod);
+    EXPECT_STR(parsed, "syntax @15 2:5 expected identifier or a literal but got TOK_EQ\n", "parsed");
+    free(parsed);
+
+    // The redeclaration of `a` counts as one of its declarations.
+    EXPECT(!ts_bind(mod), "bind succeeded despite a redeclaration");
+    char *bound = dump(mod);
+    EXPECT_STR(bound,
+               "syntax @15 2:5 expected identifier or a literal but got TOK_EQ\n"
+               "redeclaration @20 3:1 cannot redeclare a; first declared at 1:1\n"
+               "symbol T type x1 @31 4:1\n"
+               "symbol a value type x3 @0 1:1\n"
+               "symbol b value x1 @49 5:1\n",
+               "bound");
+
+    // Binding again changes nothing.
+    EXPECT(!ts_bind(mod), "second bind succeeded");
+    char *rebound = dump(mod);
+    EXPECT_STR(rebound, bound, "bound twice");
+    free(rebound);
+    free(bound);
+
+    EXPECT(!ts_check(mod), "check succeeded despite an unknown type");
+    char *checked = dump(mod);
+    EXPECT_STR(checked,
+               "syntax @15 2:5 expected identifier or a literal but got TOK_EQ\n"
+               "redeclaration @20 3:1 cannot redeclare a; first declared at 1:1\n"
+               "type @31 4:1 cannot find type Missing\n"
+               "symbol T type x1 @31 4:1\n"
+               "symbol a value type x3 @0 1:1\n"
+               "symbol b value x1 @49 5:1\n",
+               "checked");
+
+    // Checking again reports the same errors rather than adding to them.
+    EXPECT(!ts_check(mod), "second check succeeded");
+    char *rechecked = dump(mod);
+    EXPECT_STR(rechecked, checked, "checked twice");
+    free(rechecked);
+    free(checked);
+
+    // Modules in one context are independent of each other.
+    const char *valid = "type N = number;\nlet n: N = 1;\n";
+    TsModule *other = ts_parse(ctx, valid, strlen(valid));
+    EXPECT(ts_check(other), "valid module failed to check");
+    char *other_dump = dump(other);
+    EXPECT_STR(other_dump, "symbol N type x1 @0 1:1\nsymbol n value x1 @17 2:1\n", "valid module");
+    free(other_dump);
+    EXPECT(ts_diagnostic_count(mod) == 3, "%d diagnostics after another module", ts_diagnostic_count(mod));
+
+    // Too large to parse; the source isn't read.
+    EXPECT(ts_parse(ctx, source, (size_t) -1) == NULL, "parsed an oversized source");
+    ts_context_destroy(ctx);
+}
+
+static void test_empty(void) {
+    TsContext *ctx = ts_context_create();
+    TsModule *mod = ts_parse(ctx, "", 0);
+    EXPECT(ts_symbol_count(mod) == 0, "unbound module has symbols");
+    EXPECT(ts_check(mod), "empty module failed to check");
+    EXPECT(ts_diagnostic_count(mod) == 0, "empty module has diagnostics");
+    EXPECT(ts_symbol_count(mod) == 0, "empty module has symbols");
+    ts_context_destroy(ctx);
+
+    // A context with nothing in it.
+    ts_context_destroy(ts_context_create());
+}
+
+// Statements of every kind, with errors of every phase spread through
+// them.
+static char *generate(size_t *len) {
+    char *text;
+    FILE *out = open_memstream(&text, len);
+    for (int i = 0; i < 2000; i++) {
+        switch (i % 5) {
+            case 0:
+                fprintf(out, "type T%d = %s;\n", i, i % 35 == 0 ? "Missing" : "number");
+                break;
+            case 1:
+                fprintf(out, "let v%d: T%d = %d;\n", i % 700, i - 1, i);
+                break;
+            case 2:
+                fprintf(out, "v%d = v%d = 1;\n", i / 2, i / 3);
+                break;
+            case 3:
+                fprintf(out, i % 50 == 3 ? "let = %d;\n" : "let w%d = 1;\n", i);
+                break;
+            default:
+                fprintf(out, "type A%d = T%d;\n", i, i + 1);
+                break;
+        }
+    }
+    fclose(out);
+    return text;
+}
+
+typedef struct {
+    const char *source;
+    size_t len;
+    const char *want;
+    int mismatches;
+} ThreadCase;
+
+// Builds its own context over and over and compares every result with the
+// serial one.
+static void *run_thread(void *arg) {
+    ThreadCase *test = arg;
+    for (int round = 0; round < API_TEST_THREAD_ROUNDS; round++) {
+        TsContext *ctx = ts_context_create();
+        TsModule *mod = ts_parse(ctx, test->source, test->len);
+        ts_check(mod);
+        char *got = dump(mod);
+        test->mismatches += strcmp(got, test->want) != 0;
+        free(got);
+        ts_context_destroy(ctx);
+    }
+    return NULL;
+}
+
+static void test_threads(void) {
+    size_t len;
+    char *generated = generate(&len);
+    TsContext *ctx = ts_context_create();
+    TsModule *mod = ts_parse(ctx, generated, len);
+    ts_check(mod);
+    EXPECT(ts_diagnostic_count(mod) > 0, "generated source has no errors");
+    char *want = dump(mod);
+    ts_context_destroy(ctx);
+
+    // The threads share the source, which none of them writes to.
+    ThreadCase cases[API_TEST_THREADS];
+    pthread_t threads[API_TEST_THREADS];
+    for (int i = 0; i < API_TEST_THREADS; i++) {
+        cases[i] = (ThreadCase) {.source = generated, .len = len, .want = want, .mismatches = 0};
+        pthread_create(&threads[i], NULL, run_thread, &cases[i]);
+    }
+    for (int i = 0; i < API_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        EXPECT(cases[i].mismatches == 0, "thread %d: %d mismatched rounds", i, cases[i].mismatches);
+    }
+    free(want);
+    free(generated);
+}
+
+int main(void) {
+    test_phases();
+    test_empty();
+    test_threads();
+    return test_finish();
+}
@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "edit.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+// Differential test of module_edit: random programs are edited a few times
+// in a row, and after every edit the module must match a fresh parse and
+// bind of the edited text, down to positions, diagnostics, symbols and uses.
+// Programs often end mid-statement and edits are biased towards the end of
+// the input, where the reparse window and stop offsets run out.
+
+#define EDIT_TEST_ROUNDS 3000
+#define EDIT_TEST_EDITS 8
+#define EDIT_TEST_MAX_LEN 4096
+
+static const char *const statement_shapes[] = {
+        "let a%d = 1;",
+        "let b%d: T = c = 2;",
+        "type T%d = number;",
+        "x%d = y;",
+        "let a = %d;",
+        "type T = U%d;",
+        "let c%d = ;",
+        "7%d;",
+};
+
+// Ways a program can end: a complete statement, or cut off mid-statement.
+static const char *const endings[] = {"let zzz = 0;\n", "let zzz = 0;", "", "let zzz = ", "type Z", "q = 1"};
+
+static const char *const insertions[] = {
+        "", "let q = 3;", "\n", " ", "a", "b", ";", "= 5", "type", "let", "1", "let z = ;",
+        "type T = U;", "x = y = 2;", ": T", "let a = 1;\n", "zz", ":", "let a: T = a;", "2",
+};
+
+static size_t generate(char *src) {
+    size_t len = 0;
+    int statements = rand() % 8;
+    for (int i = 0; i < statements; i++) {
+        len += (size_t) sprintf(src + len, statement_shapes[(size_t) rand() % COUNT(statement_shapes)], rand() % 3);
+        len += (size_t) sprintf(src + len, "%s", rand() % 2 ? "\n" : " ");
+    }
+    len += (size_t) sprintf(src + len, "%s", endings[(size_t) rand() % COUNT(endings)]);
+    return len;
+}
+
+// Applies the edit to both `mod` and the text in `*src`, which has room for
+// EDIT_TEST_MAX_LEN bytes, then compares the module with a fresh parse and
+// bind of the new text. Returns false on a mismatch.
+static bool edit_and_compare(Module *mod,
+                             char **src,
+                             size_t *len,
+                             size_t offset,
+                             size_t removed,
+                             const char *inserted,
+                             const char *what) {
+    size_t inserted_len = strlen(inserted);
+    char *next = malloc(EDIT_TEST_MAX_LEN);
+    memcpy(next, *src, offset);
+    memcpy(next + offset, inserted, inserted_len);
+    memcpy(next + offset + inserted_len, *src + offset + removed, *len - offset - removed);
+    size_t next_len = *len - removed + inserted_len;
+
+    module_edit(mod, offset, removed, inserted, inserted_len);
+    Module *fresh = test_parse_and_bind(next, next_len);
+    char *edited_dump = test_dump_module(mod);
+    char *fresh_dump = test_dump_module(fresh);
+    bool same = strcmp(edited_dump, fresh_dump) == 0;
+    EXPECT(same,
+           "%s: replacing %zu bytes at %zu of \"%.*s\" with \"%s\"\n--- edited:\n%s--- fresh:\n%s",
+           what,
+           removed,
+           offset,
+           (int) *len,
+           *src,
+           inserted,
+           edited_dump,
+           fresh_dump);
+    free(edited_dump);
+    free(fresh_dump);
+    module_destroy(fresh);
+    free(*src);
+    *src = next;
+    *len = next_len;
+    return same;
+}
+
+static void test_round(int round) {
+    char *src = malloc(EDIT_TEST_MAX_LEN);
+    size_t len = generate(src);
+    Module *mod = test_parse_and_bind(src, len);
+
+    for (int edit = 0; edit < EDIT_TEST_EDITS; edit++) {
+        size_t offset;
+        if (rand() % 3 == 0) {
+            // At or just before the end.
+            size_t back = (size_t) rand() % 4;
+            offset = back > len ? 0 : len - back;
+        } else {
+            offset = (size_t) rand() % (len + 1);
+        }
+        size_t removed = rand() % 3 == 0 ? 0 : (size_t) rand() % (len - offset + 1);
+        if (removed > 6 && rand() % 2) {
+            removed = (size_t) rand() % 7;
+        }
+        if (offset + removed > len) {
+            removed = len - offset;
+        }
+        const char *inserted = insertions[(size_t) rand() % COUNT(insertions)];
+        if (len - removed + strlen(inserted) >= EDIT_TEST_MAX_LEN) {
+            break;
+        }
+
+        char what[48];
+        snprintf(what, sizeof(what), "round %d edit %d", round, edit);
+        if (!edit_and_compare(mod, &src, &len, offset, removed, inserted, what)) {
+            break;
+        }
+    }
+    module_destroy(mod);
+    free(src);
+}
+
+// Around PARSER_MAX_ERRORS, where a merged list must match a fresh parse's
+// cap: errors fixed before it bring the next hidden one into view, and
+// errors added past it stay hidden.
+static void test_error_cap(void) {
+    char *src = malloc(EDIT_TEST_MAX_LEN);
+    size_t len = 0;
+    for (int i = 0; i < PARSER_MAX_ERRORS + 5; i++) {
+        len += (size_t) sprintf(src + len, "let = %d;\nlet v%d = 1;\n", i % 10, i);
+    }
+    Module *mod = test_parse_and_bind(src, len);
+
+    // Fix the first error, break a good statement past the cap, then fix
+    // errors until the list is under the cap and break some again.
+    bool ok = edit_and_compare(mod, &src, &len, 4, 0, "a", "fix the first error");
+    ok = ok && edit_and_compare(mod, &src, &len, len - 3, 1, "", "break the last statement");
+    for (int i = 0; ok && i < 8; i++) {
+        const char *broken = strstr(src, "let = ");
+        ok = edit_and_compare(mod, &src, &len, (size_t) (broken - src) + 4, 0, "b", "fix an error");
+    }
+    for (int i = 0; ok && i < 8; i++) {
+        const char *good = strstr(src, "let v");
+        ok = edit_and_compare(mod, &src, &len, (size_t) (good - src) + 4, 2, "", "break a statement");
+    }
+    for (int edit = 0; ok && edit < 200; edit++) {
+        size_t offset = (size_t) rand() % (len + 1);
+        size_t removed = offset < len ? (size_t) rand() % 3 : 0;
+        if (offset + removed > len) {
+            removed = len - offset;
+        }
+        const char *inserted = insertions[(size_t) rand() % COUNT(insertions)];
+        if (len - removed + strlen(inserted) >= EDIT_TEST_MAX_LEN) {
+            break;
+        }
+        char what[48];
+        snprintf(what, sizeof(what), "capped edit %d", edit);
+        ok = edit_and_compare(mod, &src, &len, offset, removed, inserted, what);
+    }
+    module_destroy(mod);
+    free(src);
+}
+
+#define EDIT_TEST_MEMORY_EDITS 5000
+
+// A daemon edits and rechecks one module for as long as it runs, so the
+// messages of rebuilt diagnostics must not pile up.
+static void test_memory(void) {
+    char *src = NULL;
+    for (int i = 0; i < 200; i++) {
+        char line[64];
+        // Redeclarations and unknown types on every other line.
+        int n = snprintf(line, sizeof(line), i % 2 ? "let a%d: Q%d = %d;\n" : "let v%d = %d;\n", i / 4, i, i % 10);
+        memcpy(sb_add(src, n), line, (size_t) n);
+    }
+    Module *mod = test_parse_and_bind(src, (size_t) sb_count(src));
+    module_check(mod);
+
+    size_t bind_bytes = 0;
+    size_t check_bytes = 0;
+    for (int edit = 0; edit < EDIT_TEST_MEMORY_EDITS; edit++) {
+        // The digit before the last ";\n".
+        char digit = (char) ('0' + edit % 10);
+        module_edit(mod, mod->source_len - 3, 1, &digit, 1);
+        module_check(mod);
+        if (edit == 0) {
+            bind_bytes = mod->bind_arena->chunk_bytes;
+            check_bytes = mod->check_arena->chunk_bytes;
+        }
+    }
+    EXPECT(sb_count(mod->bind_diagnostics) == 100, "%d redeclarations", sb_count(mod->bind_diagnostics));
+    EXPECT(sb_count(mod->check_diagnostics) == 100, "%d unknown types", sb_count(mod->check_diagnostics));
+    EXPECT(mod->bind_arena->chunk_bytes <= bind_bytes,
+           "redeclaration messages grew from %zu to %zu bytes",
+           bind_bytes,
+           mod->bind_arena->chunk_bytes);
+    EXPECT(mod->check_arena->chunk_bytes <= check_bytes,
+           "type error messages grew from %zu to %zu bytes",
+           check_bytes,
+           mod->check_arena->chunk_bytes);
+    module_destroy(mod);
+    sb_free(src);
+}
+
+int main(void) {
+    test_memory();
+    srand(16);
+    test_error_cap();
+    for (int round = 0; round < EDIT_TEST_ROUNDS && test_failures < 5; round++) {
+        test_round(round);
+    }
+    return test_finish();
+}
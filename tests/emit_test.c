@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "emit.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+// Golden outputs of module_emit_js. The language has no strings or
+// comments yet, so the `:` and `;` that could be mistaken for an
+// annotation or the end of an alias are those of neighbouring statements.
+
+typedef struct {
+    const char *name;
+    const char *source;
+    const char *js;
+} EmitCase;
+
+static const EmitCase emit_cases[] = {
+        {"empty", "", ""},
+        {"no declarations", "x = y = 1;\n7;\n", "x = y = 1;\n7;\n"},
+        {"unannotated let", "let a = 1;\nlet b = a = 2;\n", "let a = 1;\nlet b = a = 2;\n"},
+        {"annotated let", "let a: number = 1;\n", "let a = 1;\n"},
+        {"annotation without spaces", "let a:T=1;\n", "let a=1;\n"},
+        {"annotation with extra spaces", "let a \t:  \tT   = 1;\n", "let a \t   = 1;\n"},
+        {"annotation across lines", "let a:\n  T\n  = 1;\n", "let a\n  = 1;\n"},
+        {"annotated chain", "let a: T = b = c;\n", "let a = b = c;\n"},
+        // The line break after an alias is kept, so lines don't move.
+        {"alias", "type T = number;\nlet a: T = 1;\n", "\nlet a = 1;\n"},
+        {"alias across lines", "type\nT\n=\nnumber\n;\nlet a = 1;\n", "\nlet a = 1;\n"},
+        {"aliases on one line", "type A = B;type C = D; let a: A = 1;", " let a = 1;"},
+        {"alias then statement on its line", "type T = U; x = 1;\n", " x = 1;\n"},
+        // The alias is cut through its own `;`, not the next statement's.
+        {"alias between lets", "let a = 1; type T = U; let b: T = a;\n", "let a = 1;  let b = a;\n"},
+        // A `:` later on the line belongs to the next annotated let.
+        {"unannotated let before annotated", "let a = 1; let b: T = 2;\n", "let a = 1; let b = 2;\n"},
+        {"no trailing newline", "let a: T = 1;", "let a = 1;"},
+        {"alias at the end", "let a = 1;\ntype T = U;", "let a = 1;\n"},
+        {"leading and trailing space", "\n\n  let a: T = 1;  \n\n", "\n\n  let a = 1;  \n\n"},
+};
+
+// Emits `source`, which must parse, into a string.
+static char *emit(const char *source, size_t len) {
+    Module *mod = test_parse(source, len);
+    EXPECT(sb_count(mod->diagnostics) == 0,
+           "%s: %s",
+           source,
+           sb_count(mod->diagnostics) > 0 ? mod->diagnostics[0].message : "");
+
+    FILE *file = tmpfile();
+    Emitter emitter;
+    emitter_init(&emitter, fileno(file));
+    module_emit_js(mod, &emitter);
+    EXPECT(emitter_finish(&emitter), "emitting %s failed", source);
+    module_destroy(mod);
+
+    // The emitter wrote through the descriptor, past the stream's buffer.
+    off_t size = lseek(fileno(file), 0, SEEK_CUR);
+    char *js = malloc((size_t) size + 1);
+    rewind(file);
+    size_t read = fread(js, 1, (size_t) size, file);
+    js[read] = '\0';
+    fclose(file);
+    return js;
+}
+
+static void test_cases(void) {
+    for (size_t i = 0; i < COUNT(emit_cases); i++) {
+        const EmitCase *test = &emit_cases[i];
+        char *js = emit(test->source, strlen(test->source));
+        EXPECT_STR(js, test->js, test->name);
+        free(js);
+    }
+}
+
+// Output several times the emitter's buffer, so spans are flushed and
+// written straight through as well as copied.
+static void test_large(void) {
+    char *source = NULL;
+    char *want = NULL;
+    for (int i = 0; i < 100000; i++) {
+        char statement[64];
+        char js[64];
+        switch (i % 4) {
+            case 0:
+                snprintf(statement, sizeof(statement), "type T%d = number;\n", i);
+                snprintf(js, sizeof(js), "\n");
+                break;
+            case 1:
+                snprintf(statement, sizeof(statement), "let a%d: T%d = %d;\n", i, i - 1, i);
+                snprintf(js, sizeof(js), "let a%d = %d;\n", i, i);
+                break;
+            default:
+                snprintf(statement, sizeof(statement), "x = a%d;\n", i);
+                snprintf(js, sizeof(js), "x = a%d;\n", i);
+                break;
+        }
+        memcpy(sb_add(source, (int) strlen(statement)), statement, strlen(statement));
+        memcpy(sb_add(want, (int) strlen(js)), js, strlen(js));
+    }
+    // One statement longer than the buffer.
+    size_t long_len = 3 * 1024 * 1024;
+    char *space = sb_add(source, (int) long_len);
+    memset(space, ' ', long_len);
+    memcpy(space, "let z", 5);
+    memcpy(space + long_len - 8, ": T = 1;", 8);
+    space = sb_add(want, (int) long_len - 3);
+    memset(space, ' ', long_len - 3);
+    memcpy(space, "let z", 5);
+    memcpy(space + long_len - 8, " = 1;", 5);
+    sb_push(want, '\0');
+
+    char *js = emit(source, (size_t) sb_count(source));
+    EXPECT(strcmp(js, want) == 0, "large output differs (%zu bytes, want %zu)", strlen(js), strlen(want));
+    free(js);
+    sb_free(source);
+    sb_free(want);
+}
+
+int main(void) {
+    test_cases();
+    test_large();
+    return test_finish();
+}
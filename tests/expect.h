@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+// Minimal assertions for the test binaries. A failed EXPECT reports itself
+// and the test carries on; main returns test_finish() so the run fails if
+// any did.
+
+static int test_failures = 0;
+
+#define COUNT(__array) (sizeof(__array) / sizeof((__array)[0]))
+
+#define EXPECT(__cond, ...) \
+    do { \
+        if (!(__cond)) { \
+            fprintf(stderr, "%s:%d: expected %s: ", __FILE__, __LINE__, #__cond); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            test_failures++; \
+        } \
+    } while (0)
+
+// Compares two NUL-terminated strings and prints both on a mismatch.
+#define EXPECT_STR(__actual, __expected, __what) \
+    do { \
+        const char *__a = (__actual); \
+        const char *__e = (__expected); \
+        EXPECT(strcmp(__a, __e) == 0, "%s\n--- got:\n%s\n--- want:\n%s", (__what), __a, __e); \
+    } while (0)
+
+static inline int test_finish(void) {
+    if (test_failures > 0) {
+        fprintf(stderr, "%d failed\n", test_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "number.h"
+#include "tests/test.h"
+
+// number_scan's values, compared bit for bit with strtod (or an exact
+// expected double for radix literals), and the literals it rejects. Each
+// literal is copied into a buffer of its exact length so a sanitizer
+// catches reads past the end, and is scanned with the scalar kernels as
+// well as the best ones.
+
+#define NUMBER_TEST_ROUNDS 200000
+
+typedef struct {
+    const char *literal;
+    // Where the literal ends, for those followed by something else.
+    size_t end;
+    double value;
+} NumberCase;
+
+// Decimal literals whose value strtod must agree with.
+static const char *const decimal_cases[] = {
+        // Plain integers.
+        "0",
+        "7",
+        "1234567890123456789",
+        "9007199254740992",
+        "9007199254740993",
+        "18446744073709551615",
+        // Clinger's fast path and either side of its limits: a mantissa up
+        // to 2^53 and a power of ten up to 1e22.
+        "1.5",
+        ".5",
+        "1.",
+        "1.e5",
+        "0.1",
+        "3.14159",
+        "1e22",
+        "1e23",
+        "1e-22",
+        "1e-23",
+        "9007199254740992e22",
+        "9007199254740993e22",
+        "9007199254740992e-22",
+        "9007199254740993e-22",
+        "9007199254740992.5",
+        "900719925474099.3e1",
+        "123456789e15",
+        "4.35679e-22",
+        "1_000.000_1e1_0",
+        "0.000_001",
+        "1E+5",
+        "1e-0",
+        // Past 19 digits, including halfway cases that only a digit far
+        // beyond the 19th decides.
+        "12345678901234567890123",
+        "0.1000000000000000000001",
+        "9007199254740993.00000000000000000001",
+        "9007199254740993.00000000000000000000",
+        "90071992547409930000000000000000000000000001e-28",
+        "1000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001",
+        "0.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001",
+        // Subnormals and the smallest double either side of rounding to 0.
+        "2.2250738585072014e-308",
+        "2.2250738585072011e-308",
+        "4.9406564584124654e-324",
+        "2.4703282292062328e-324",
+        "2.4703282292062327e-324",
+        "1e-400",
+        "1e-400000000000",
+        // The largest double and overflow to infinity.
+        "1.7976931348623157e308",
+        "1.7976931348623158e308",
+        "1.7976931348623159e308",
+        "1e309",
+        "1e400000000000",
+        // Zero however it is written.
+        "0.0",
+        "0e5",
+        "0.000e-400",
+        "0.0000000000000000000000000",
+};
+
+static const NumberCase radix_cases[] = {
+        {"0x0", 0, 0},
+        {"0xff_FF", 0, 65535},
+        {"0XaB", 0, 171},
+        {"0b1_0_1", 0, 5},
+        {"0B11", 0, 3},
+        {"0o7_7", 0, 63},
+        {"0O10", 0, 8},
+        {"0x1f;", 4, 31},
+        {"0x1FFFFFFFFFFFFF", 0, 9007199254740991.0},
+        // 2^53 + 1 is halfway between two doubles and rounds to even.
+        {"0x20000000000001", 0, 9007199254740992.0},
+        {"0x20000000000003", 0, 9007199254740996.0},
+        {"0xFFFFFFFFFFFFFFFF", 0, 18446744073709551616.0},
+        // Past 64 bits the halfway 2^53 + 1 is kept, and the nonzero digits
+        // after it round up only through the sticky bit.
+        {"0x20000000000001000", 0, 0x20000000000000p12},
+        {"0x20000000000001001", 0, 0x20000000000002p12},
+        {"0x20000000000001000000000000000000000000000000000", 0, 0x20000000000000p132},
+        {"0x20000000000001000000000000000000000000000000001", 0, 0x20000000000002p132},
+        {"0b1000000000000000000000000000000000000000000000000000010000000000000000000000", 0, 0x20000000000000p22},
+        {"0b1000000000000000000000000000000000000000000000000000010000000000000000000001", 0, 0x20000000000002p22},
+        {"0o4000000000000000010000", 0, 0x20000000000000p12},
+        {"0o4000000000000000010001", 0, 0x20000000000002p12},
+        // Just below halfway is rounded down whatever follows.
+        {"0x20000000000000FFF", 0, 0x20000000000000p12},
+};
+
+// Every malformed literal number.h lists, and where it ends.
+static const NumberCase invalid_cases[] = {
+        // Misplaced separators.
+        {"1__0", 0, 0},
+        {"1_", 0, 0},
+        {"1_;", 2, 0},
+        {"1_.5", 0, 0},
+        {"1._5", 0, 0},
+        {"1.5_", 0, 0},
+        {"1_e5", 0, 0},
+        {"1e_5", 0, 0},
+        {"1e+_5", 0, 0},
+        {"1e5_", 0, 0},
+        {"1e5__0", 0, 0},
+        {"0_1", 0, 0},
+        {"0x_1", 0, 0},
+        {"0x1_", 0, 0},
+        {"0x1__2", 0, 0},
+        {"0b_1", 0, 0},
+        {"0b1_", 0, 0},
+        {"0o_7", 0, 0},
+        {"0o7__7", 0, 0},
+        // Missing exponent or radix digits.
+        {"1e", 0, 0},
+        {"1e+", 0, 0},
+        {"1e-;", 3, 0},
+        {"1.5E", 0, 0},
+        {"0x", 0, 0},
+        {"0b", 0, 0},
+        {"0o", 0, 0},
+        {"0x;", 2, 0},
+        {"0b2", 0, 0},
+        {"0o8", 0, 0},
+        // A leading zero followed by more digits.
+        {"00", 0, 0},
+        {"01", 0, 0},
+        {"0123", 0, 0},
+        {"00.5", 0, 0},
+        {"01e5", 0, 0},
+        // An identifier character right after the literal, which the
+        // literal extends over.
+        {"1px", 0, 0},
+        {"1px;", 3, 0},
+        {"1.5a", 0, 0},
+        {"1.toString", 0, 0},
+        {"1e5x", 0, 0},
+        {"1_000n", 0, 0},
+        {"0x1g", 0, 0},
+        {"0xg;", 3, 0},
+        {"0b12", 0, 0},
+        {"0o78", 0, 0},
+        {"12345678901234567890abc", 0, 0},
+};
+
+static bool same_double(double a, double b) {
+    uint64_t a_bits;
+    uint64_t b_bits;
+    memcpy(&a_bits, &a, sizeof(a));
+    memcpy(&b_bits, &b, sizeof(b));
+    return a_bits == b_bits;
+}
+
+// Scans `literal` from the start of an exactly sized copy of it.
+static bool scan(const char *literal, ScanKernel skip_digits, size_t *end, double *value) {
+    size_t len = strlen(literal);
+    char *source = malloc(len > 0 ? len : 1);
+    memcpy(source, literal, len);
+    *end = 0;
+    *value = 0;
+    bool valid = number_scan(source, len, skip_digits, end, value);
+    free(source);
+    return valid;
+}
+
+// Scans a valid literal with every kernel and compares it with `want`.
+// Reports the first mismatch only.
+static bool expect_value(const char *literal, size_t want_end, double want) {
+    const ScanKernels *kernels[] = {scan_kernels_scalar(), scan_kernels_best()};
+    if (want_end == 0) {
+        want_end = strlen(literal);
+    }
+    for (size_t i = 0; i < COUNT(kernels); i++) {
+        size_t end;
+        double value;
+        bool valid = scan(literal, kernels[i]->skip_digits, &end, &value);
+        if (!valid || end != want_end || !same_double(value, want)) {
+            EXPECT(false,
+                   "%s (%s kernels): %s, ends at %zu, %.17g; want valid, ends at %zu, %.17g",
+                   literal,
+                   kernels[i]->name,
+                   valid ? "valid" : "invalid",
+                   end,
+                   value,
+                   want_end,
+                   want);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_decimal(void) {
+    for (size_t i = 0; i < COUNT(decimal_cases); i++) {
+        const char *literal = decimal_cases[i];
+        char *digits = malloc(strlen(literal) + 1);
+        size_t n = 0;
+        for (const char *c = literal; *c != '\0'; c++) {
+            if (*c != '_') {
+                digits[n++] = *c;
+            }
+        }
+        digits[n] = '\0';
+        expect_value(literal, 0, strtod(digits, NULL));
+        free(digits);
+    }
+
+    // The edges themselves, so a change to strtod doesn't hide a mistake.
+    expect_value("1e22", 0, 1e22);
+    expect_value("9007199254740993", 0, 9007199254740992.0);
+    expect_value("2.4703282292062327e-324", 0, 0);
+    expect_value("2.4703282292062328e-324", 0, 0x1p-1074);
+    expect_value("1e309", 0, INFINITY);
+    expect_value("1.7976931348623159e308", 0, INFINITY);
+}
+
+static void test_radix(void) {
+    for (size_t i = 0; i < COUNT(radix_cases); i++) {
+        expect_value(radix_cases[i].literal, radix_cases[i].end, radix_cases[i].value);
+    }
+
+    // More digits than a double's range: infinity, as in JavaScript.
+    char literal[2 + 300 + 1] = "0x";
+    memset(literal + 2, 'f', 300);
+    literal[302] = '\0';
+    expect_value(literal, 0, INFINITY);
+}
+
+static void test_invalid(void) {
+    const ScanKernels *kernels[] = {scan_kernels_scalar(), scan_kernels_best()};
+    for (size_t i = 0; i < COUNT(invalid_cases); i++) {
+        const NumberCase *test = &invalid_cases[i];
+        size_t want_end = test->end != 0 ? test->end : strlen(test->literal);
+        for (size_t j = 0; j < COUNT(kernels); j++) {
+            size_t end;
+            double value;
+            bool valid = scan(test->literal, kernels[j]->skip_digits, &end, &value);
+            EXPECT(!valid, "%s (%s kernels): valid", test->literal, kernels[j]->name);
+            EXPECT(end == want_end,
+                   "%s (%s kernels): ends at %zu, want %zu",
+                   test->literal,
+                   kernels[j]->name,
+                   end,
+                   want_end);
+        }
+    }
+}
+
+// Appends `count` random digits, the first of them nonzero if `nonzero`.
+static size_t random_digits(char *buf, size_t n, int count, bool nonzero) {
+    for (int i = 0; i < count; i++) {
+        buf[n++] = (char) ('0' + (i == 0 && nonzero ? 1 + rand() % 9 : rand() % 10));
+    }
+    return n;
+}
+
+// Random literals of every length, and mantissas around 2^53 with powers of
+// ten around 1e22, all compared with strtod.
+static void test_random(void) {
+    srand(20);
+    for (int round = 0; round < NUMBER_TEST_ROUNDS; round++) {
+        char literal[128];
+        size_t n = 0;
+        if (round % 2 == 0) {
+            int whole = rand() % 25;
+            int fraction = rand() % 25;
+            if (whole == 0 && fraction == 0) {
+                whole = 1;
+            }
+            n = whole == 1 ? random_digits(literal, n, 1, false) : random_digits(literal, n, whole, true);
+            if (fraction > 0 || rand() % 4 == 0) {
+                literal[n++] = '.';
+                n = random_digits(literal, n, fraction, false);
+            }
+            if (rand() % 2 == 0) {
+                n += (size_t) snprintf(literal + n, sizeof(literal) - n, "e%d", rand() % 700 - 350);
+            }
+        } else {
+            uint64_t mantissa = ((uint64_t) 1 << 53) - 64 + (uint64_t) (rand() % 128);
+            n = (size_t) snprintf(literal, sizeof(literal), "%llue%d", (unsigned long long) mantissa, rand() % 51 - 25);
+        }
+        literal[n] = '\0';
+        if (!expect_value(literal, 0, strtod(literal, NULL))) {
+            return;
+        }
+    }
+}
+
+int main(void) {
+    test_decimal();
+    test_radix();
+    test_invalid();
+    test_random();
+    return test_finish();
+}
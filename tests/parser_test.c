@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+// Error recovery: which statements survive a syntax error, which errors
+// are reported, the cap on how many, and that a chunked parse reports the
+// same ones.
+
+typedef struct {
+    const char *source;
+    ParseResult res;
+    // test_dump_module's statements and diagnostics.
+    const char *dump;
+} RecoveryCase;
+
+static const RecoveryCase recovery_cases[] = {
+        // Recovery after the next ';'.
+        {"let a = ; let b = 1;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@10 let b: - = @18 1\n"
+         "parse DIAGNOSTIC_SYNTAX @8 expected identifier or a literal but got TOK_SEMICOLON\n"},
+        {"let a = 1 x = 2; let b = 3;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@17 let b: - = @25 3\n"
+         "parse DIAGNOSTIC_SYNTAX @10 expected a token of type TOK_SEMICOLON, got TOK_IDENT\n"},
+        {"= = = ; let a = 1;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@8 let a: - = @16 1\n"
+         "parse DIAGNOSTIC_SYNTAX @0 expected identifier or a literal but got TOK_EQ\n"},
+        // Recovery at a keyword, so a missing ';' costs one statement.
+        {"let a = 1 let b = 2;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@10 let b: - = @18 2\n"
+         "parse DIAGNOSTIC_SYNTAX @10 expected a token of type TOK_SEMICOLON, got TOK_LET\n"},
+        {"type T = number let x: T = 1;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@16 let x: T = @27 1\n"
+         "parse DIAGNOSTIC_SYNTAX @16 expected a token of type TOK_SEMICOLON, got TOK_LET\n"},
+        {"let let let a = 1;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@8 let a: - = @16 1\n"
+         "parse DIAGNOSTIC_SYNTAX @4 expected identifier or a literal but got TOK_LET\n"
+         "parse DIAGNOSTIC_SYNTAX @8 expected identifier or a literal but got TOK_LET\n"},
+        // Input that ends mid-statement.
+        {"let a = 1; let b =",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "@0 let a: - = @8 1\n"
+         "parse DIAGNOSTIC_SYNTAX @18 expected identifier or a literal but got TOK_END_OF_FILE\n"},
+        {"let", PARSE_RESULT_UNEXPECTED_TOK, "parse DIAGNOSTIC_SYNTAX @3 expected identifier or a literal but got TOK_END_OF_FILE\n"},
+        {"type T", PARSE_RESULT_UNEXPECTED_TOK, "parse DIAGNOSTIC_SYNTAX @6 expected a token of type TOK_EQ, got TOK_END_OF_FILE\n"},
+        {"x = y =", PARSE_RESULT_UNEXPECTED_TOK, "parse DIAGNOSTIC_SYNTAX @7 expected identifier or a literal but got TOK_END_OF_FILE\n"},
+        {"let a: ", PARSE_RESULT_UNEXPECTED_TOK, "parse DIAGNOSTIC_SYNTAX @7 expected identifier or a literal but got TOK_END_OF_FILE\n"},
+        {"let a = 1", PARSE_RESULT_UNEXPECTED_TOK, "parse DIAGNOSTIC_SYNTAX @9 expected a token of type TOK_SEMICOLON, got TOK_END_OF_FILE\n"},
+        // The result is that of the first statement that failed.
+        {"let a = 1e; let b = ;",
+         PARSE_RESULT_INVALID_NUMERIC_LITERAL,
+         "parse DIAGNOSTIC_SYNTAX @8 invalid numeric literal 1e\n"
+         "parse DIAGNOSTIC_SYNTAX @20 expected identifier or a literal but got TOK_SEMICOLON\n"},
+        {"let b = ; let a = 1e;",
+         PARSE_RESULT_UNEXPECTED_TOK,
+         "parse DIAGNOSTIC_SYNTAX @8 expected identifier or a literal but got TOK_SEMICOLON\n"
+         "parse DIAGNOSTIC_SYNTAX @18 invalid numeric literal 1e\n"},
+};
+
+// test_dump_module without the line starts.
+static char *dump_parsed(Module *mod) {
+    char *dump = test_dump_module(mod);
+    char *lines = strstr(dump, "lines");
+    if (lines != NULL) {
+        *lines = '\0';
+    }
+    return dump;
+}
+
+static ParseResult parse(Module *mod) {
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    ParseResult res = parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return res;
+}
+
+static void test_recovery(void) {
+    for (size_t i = 0; i < COUNT(recovery_cases); i++) {
+        const RecoveryCase *test = &recovery_cases[i];
+        Module *mod = module_create(test->source, strlen(test->source));
+        ParseResult res = parse(mod);
+        EXPECT(res == test->res,
+               "%s: %s, want %s",
+               test->source,
+               parse_result_name(res),
+               parse_result_name(test->res));
+        char *dump = dump_parsed(mod);
+        EXPECT_STR(dump, test->dump, test->source);
+        free(dump);
+        module_destroy(mod);
+    }
+}
+
+// `errors` broken statements, each followed by `valid` good ones.
+static char *generate(int errors, int valid, size_t *len) {
+    char *src = NULL;
+    for (int i = 0; i < errors; i++) {
+        char line[64];
+        int n = snprintf(line, sizeof(line), i % 2 ? "let = %d;\n" : "x%d = ;\n", i);
+        memcpy(sb_add(src, n), line, (size_t) n);
+        for (int j = 0; j < valid; j++) {
+            n = snprintf(line, sizeof(line), "let v%d_%d = %d;\n", i, j, j);
+            memcpy(sb_add(src, n), line, (size_t) n);
+        }
+    }
+    *len = (size_t) sb_count(src);
+    return src;
+}
+
+static void test_error_cap(void) {
+    static const int error_counts[] = {PARSER_MAX_ERRORS - 1, PARSER_MAX_ERRORS, PARSER_MAX_ERRORS + 1, 1000};
+    for (size_t i = 0; i < COUNT(error_counts); i++) {
+        int errors = error_counts[i];
+        size_t len;
+        char *src = generate(errors, 2, &len);
+        Module *mod = module_create(src, len);
+        parse(mod);
+
+        int reported = errors > PARSER_MAX_ERRORS ? PARSER_MAX_ERRORS + 1 : errors;
+        EXPECT(sb_count(mod->diagnostics) == reported,
+               "%d errors: %d reported, want %d",
+               errors,
+               sb_count(mod->diagnostics),
+               reported);
+        EXPECT(sb_count(mod->statements) == errors * 2,
+               "%d errors: %d statements, want %d",
+               errors,
+               sb_count(mod->statements),
+               errors * 2);
+        if (errors > PARSER_MAX_ERRORS && sb_count(mod->diagnostics) == reported) {
+            // The note stands in for the first error past the cap.
+            Module *uncapped = module_create(src, len);
+            Lexer *lexer = lexer_create(uncapped->source, uncapped->source_len, uncapped->arena, uncapped->names);
+            Parser *parser = parser_create(lexer);
+            parser->max_errors = errors;
+            parser_parse(parser, uncapped);
+            parser_destroy(parser);
+            lexer_destroy(lexer);
+
+            EXPECT(sb_count(uncapped->diagnostics) == errors, "uncapped: %d errors", sb_count(uncapped->diagnostics));
+            const Diagnostic *note = &mod->diagnostics[PARSER_MAX_ERRORS];
+            EXPECT(note->location.pos == uncapped->diagnostics[PARSER_MAX_ERRORS].location.pos,
+                   "%d errors: note at %zu, want %zu",
+                   errors,
+                   note->location.pos,
+                   uncapped->diagnostics[PARSER_MAX_ERRORS].location.pos);
+            EXPECT_STR(note->message, "too many syntax errors; the rest are not reported", "note");
+            for (int j = 0; j < PARSER_MAX_ERRORS; j++) {
+                EXPECT(mod->diagnostics[j].location.pos == uncapped->diagnostics[j].location.pos,
+                       "%d errors: error %d moved",
+                       errors,
+                       j);
+            }
+            module_destroy(uncapped);
+        }
+        module_destroy(mod);
+        sb_free(src);
+    }
+}
+
+// However the input is split, merging the chunks' diagnostics must give
+// what one parser reports, including the cap.
+static void test_chunked(void) {
+    static const int error_counts[] = {0, 3, PARSER_MAX_ERRORS, PARSER_MAX_ERRORS + 1, 300};
+    static const int chunk_counts[] = {1, 2, 3, 7, 64};
+    Pool *pool = pool_create(4);
+    for (size_t i = 0; i < COUNT(error_counts); i++) {
+        size_t len;
+        char *src = generate(error_counts[i], 3, &len);
+        // Cut off mid-statement, so the last chunk ends in an error too.
+        if (len > 0) {
+            len -= 3;
+        }
+        Module *serial = module_create(src, len);
+        ParseResult want_res = parse(serial);
+        char *want = test_dump_module(serial);
+
+        for (size_t j = 0; j < COUNT(chunk_counts); j++) {
+            Module *mod = module_create(src, len);
+            ParseResult res = parser_parse_chunked(mod, pool, chunk_counts[j], NULL, NULL);
+            char *got = test_dump_module(mod);
+            char what[64];
+            snprintf(what, sizeof(what), "%d errors in %d chunks", error_counts[i], chunk_counts[j]);
+            EXPECT(res == want_res, "%s: %s, want %s", what, parse_result_name(res), parse_result_name(want_res));
+            EXPECT(strcmp(got, want) == 0, "%s: differs from a serial parse", what);
+            free(got);
+            module_destroy(mod);
+        }
+        free(want);
+        module_destroy(serial);
+        sb_free(src);
+    }
+    pool_destroy(pool);
+}
+
+int main(void) {
+    test_recovery();
+    test_error_cap();
+    test_chunked();
+    return test_finish();
+}
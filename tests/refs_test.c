@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "refs.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+// Checks the reference index against a brute-force walk of the AST, which
+// collects the uses of one name at a time. Statements are separated by gaps
+// of every varint width, so deltas take one to four bytes.
+
+#define REFS_TEST_ROUNDS 300
+
+static const char *const names[] = {"a", "b", "c", "T", "U"};
+
+static const char *const statement_shapes[] = {
+        "%s;",
+        "%s = 1;",
+        "%s = %s = %s;",
+        "let %s = %s;",
+        "let %s: %s = %s = 2;",
+        "type %s = %s;",
+        "let %s = ;",
+        "7;",
+};
+
+static const char *random_name(void) {
+    return names[(size_t) rand() % COUNT(names)];
+}
+
+// A gap whose length needs a varint of 1, 2, 3 or 4 bytes.
+static size_t gap_len(void) {
+    switch (rand() % 16) {
+        case 0:
+            return 128 + (size_t) rand() % 16384;
+        case 1:
+            return 16384 + (size_t) rand() % 65536;
+        case 2:
+            return rand() % 8 == 0 ? 2 * 1024 * 1024 + (size_t) rand() % 1024 : 1;
+        default:
+            return 1 + (size_t) rand() % 8;
+    }
+}
+
+static char *generate(size_t *len) {
+    char *src = NULL;
+    int statements = rand() % 12;
+    for (int i = 0; i < statements; i++) {
+        char statement[64];
+        int written = snprintf(statement,
+                               sizeof(statement),
+                               statement_shapes[(size_t) rand() % COUNT(statement_shapes)],
+                               random_name(),
+                               random_name(),
+                               random_name());
+        memcpy(sb_add(src, written), statement, (size_t) written);
+        size_t gap = gap_len();
+        char *space = sb_add(src, (int) gap);
+        for (size_t j = 0; j < gap; j++) {
+            space[j] = j % 80 == 79 ? '\n' : ' ';
+        }
+    }
+    *len = (size_t) sb_count(src);
+    return src;
+}
+
+// Appends the uses of `name` under `node`, in source order.
+static void collect_uses(const Ast *ast, NodeId node, int name, size_t **uses) {
+    if (node == AST_NONE) {
+        return;
+    }
+    switch (ast_kind(ast, node)) {
+        case NODE_EXPR_IDENT:
+            if (node_name(ast, node) == name) {
+                sb_push(*uses, ast_location(ast, node).pos);
+            }
+            break;
+        case NODE_EXPR_ASSIGNMENT:
+            if (node_name(ast, node) == name) {
+                sb_push(*uses, ast_location(ast, node).pos);
+            }
+            collect_uses(ast, expr_assignment_value(ast, node), name, uses);
+            break;
+        case NODE_DECL_LET:
+            collect_uses(ast, decl_let_init(ast, node), name, uses);
+            break;
+        case NODE_EXPR_NUM:
+        case NODE_DECL_TYPE_ALIAS:
+            break;
+    }
+}
+
+static void compare_name(Module *mod, const RefIndex *refs, int name) {
+    size_t *want = NULL;
+    for (int i = 0; i < sb_count(mod->statements); i++) {
+        collect_uses(&mod->ast, mod->statements[i], name, &want);
+    }
+    const char *text = name < interner_count(mod->names) ? interner_name(mod->names, name).text : "?";
+    EXPECT(ref_index_count(refs, name) == (uint32_t) sb_count(want),
+           "%s: %u uses indexed, walk found %d",
+           text,
+           ref_index_count(refs, name),
+           sb_count(want));
+
+    RefCursor cursor = ref_index_find(refs, name);
+    size_t pos;
+    int found = 0;
+    while (ref_cursor_next(&cursor, &pos)) {
+        if (found < sb_count(want)) {
+            EXPECT(pos == want[found], "%s: use %d at %zu, want %zu", text, found, pos, want[found]);
+        }
+        found++;
+    }
+    EXPECT(found == sb_count(want), "%s: cursor gave %d uses, want %d", text, found, sb_count(want));
+    sb_free(want);
+}
+
+static void test_random(void) {
+    srand(21);
+    for (int round = 0; round < REFS_TEST_ROUNDS; round++) {
+        size_t len;
+        char *src = generate(&len);
+        Module *mod = test_parse_and_bind(src, len);
+        const RefIndex *refs = module_references(mod);
+        for (int name = 0; name < interner_count(mod->names); name++) {
+            compare_name(mod, refs, name);
+        }
+        // Names the index doesn't know have no uses.
+        EXPECT(ref_index_count(refs, -1) == 0, "round %d: uses of name -1", round);
+        EXPECT(ref_index_count(refs, interner_count(mod->names)) == 0, "round %d: uses past the last name", round);
+        module_destroy(mod);
+        sb_free(src);
+    }
+}
+
+// Uses of `a` exactly on each side of every varint width.
+static void test_varint_boundaries(void) {
+    static const size_t deltas[] = {
+            2, 127, 128, 16383, 16384, 2097151, 2097152,
+    };
+    size_t len = 0;
+    for (size_t i = 0; i < COUNT(deltas); i++) {
+        len += deltas[i];
+    }
+    len += 2;
+    char *src = malloc(len);
+    memset(src, ' ', len);
+    size_t *want = NULL;
+    size_t pos = 0;
+    // `a;` at each position, each delta after the last.
+    for (size_t i = 0; i <= COUNT(deltas); i++) {
+        memcpy(src + pos, "a;", 2);
+        sb_push(want, pos);
+        if (i < COUNT(deltas)) {
+            pos += deltas[i];
+        }
+    }
+
+    Module *mod = test_parse_and_bind(src, len);
+    const RefIndex *refs = module_references(mod);
+    int a = interner_lookup(mod->names, "a", 1);
+    EXPECT(ref_index_count(refs, a) == (uint32_t) sb_count(want), "boundaries: %u uses", ref_index_count(refs, a));
+    RefCursor cursor = ref_index_find(refs, a);
+    for (int i = 0; i < sb_count(want); i++) {
+        size_t got = 0;
+        bool more = ref_cursor_next(&cursor, &got);
+        EXPECT(more && got == want[i], "boundaries: use %d at %zu, want %zu", i, got, want[i]);
+    }
+    EXPECT(!ref_cursor_next(&cursor, &pos), "boundaries: uses after the last");
+    module_destroy(mod);
+    sb_free(want);
+    free(src);
+}
+
+static void test_empty(void) {
+    Ast ast;
+    ast_init(&ast);
+    RefIndex *refs = ref_index_build(&ast, NULL, 0, 0);
+    EXPECT(ref_index_count(refs, 0) == 0, "empty index has uses");
+    RefCursor cursor = ref_index_find(refs, 0);
+    size_t pos;
+    EXPECT(!ref_cursor_next(&cursor, &pos), "empty index cursor has uses");
+    ref_index_destroy(refs);
+    ast_free(&ast);
+}
+
+int main(void) {
+    test_empty();
+    test_varint_boundaries();
+    test_random();
+    return test_finish();
+}
@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+#include "tests/test.h"
+
+// Differential test of the vector scan kernels against the scalar ones. A
+// run of class members followed by one other byte is scanned from every
+// start position, so runs end on and around every 16- and 32-byte block
+// boundary and leave every tail length. Buffers are allocated to their
+// exact size so a sanitizer catches reads past `len`.
+
+#define SCAN_TEST_MAX_RUN 100
+
+typedef struct {
+    const char *name;
+    const char *members;
+} ScanClass;
+
+static const ScanClass scan_classes[] = {
+        {"whitespace", " \t\n\v\f\r"},
+        {"identifier", "aZ_9qM0z"},
+        {"digits", "0123456789"},
+};
+
+static ScanKernel kernel_for(const ScanKernels *kernels, int cls) {
+    switch (cls) {
+        case 0:
+            return kernels->skip_whitespace;
+        case 1:
+            return kernels->skip_identifier;
+        default:
+            return kernels->skip_digits;
+    }
+}
+
+// Compares every start position; reports the first mismatch only.
+static bool compare_all(const ScanKernels *kernels, int cls, const char *buf, size_t len, const char *what) {
+    ScanKernel expected = kernel_for(scan_kernels_scalar(), cls);
+    ScanKernel actual = kernel_for(kernels, cls);
+    for (size_t pos = 0; pos <= len; pos++) {
+        size_t want = expected(buf, pos, len);
+        size_t got = actual(buf, pos, len);
+        if (want != got) {
+            EXPECT(want == got,
+                   "%s %s on %s (len %zu) from %zu: scalar %zu, got %zu",
+                   kernels->name,
+                   scan_classes[cls].name,
+                   what,
+                   len,
+                   pos,
+                   want,
+                   got);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_runs(const ScanKernels *kernels) {
+    for (int cls = 0; cls < 3; cls++) {
+        const char *members = scan_classes[cls].members;
+        size_t member_count = strlen(members);
+        for (size_t run = 0; run <= SCAN_TEST_MAX_RUN; run++) {
+            // 256 possible terminating bytes, or none: the run reaches len.
+            for (int end = -1; end < 256; end++) {
+                size_t len = run + (end >= 0 ? 1 : 0);
+                char *buf = malloc(len > 0 ? len : 1);
+                for (size_t i = 0; i < run; i++) {
+                    buf[i] = members[i % member_count];
+                }
+                if (end >= 0) {
+                    buf[run] = (char) end;
+                }
+                bool ok = compare_all(kernels, cls, buf, len, "run");
+                free(buf);
+                if (!ok) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// Members with high-bit bytes mixed in, where a signed-compare mistake
+// would show up as a run that doesn't stop.
+static void test_high_bytes(const ScanKernels *kernels) {
+    for (int cls = 0; cls < 3; cls++) {
+        const char *members = scan_classes[cls].members;
+        size_t member_count = strlen(members);
+        for (int high = 0x80; high < 0x100; high++) {
+            char buf[80];
+            for (size_t i = 0; i < sizeof(buf); i++) {
+                buf[i] = i % 37 == 36 ? (char) high : members[i % member_count];
+            }
+            if (!compare_all(kernels, cls, buf, sizeof(buf), "high bytes")) {
+                return;
+            }
+        }
+    }
+}
+
+static void test_random(const ScanKernels *kernels) {
+    srand(1);
+    size_t len = 64 * 1024;
+    char *buf = malloc(len);
+    for (int cls = 0; cls < 3; cls++) {
+        const char *members = scan_classes[cls].members;
+        size_t member_count = strlen(members);
+        for (size_t i = 0; i < len; i++) {
+            // Mostly members, so runs are long enough to cross blocks.
+            buf[i] = rand() % 8 != 0 ? members[(size_t) rand() % member_count] : (char) (rand() % 256);
+        }
+        compare_all(kernels, cls, buf, len, "random");
+    }
+    free(buf);
+}
+
+int main(void) {
+    const ScanKernels *vector[] = {scan_kernels_sse2(), scan_kernels_avx2()};
+    int tested = 0;
+    for (int i = 0; i < 2; i++) {
+        if (vector[i] == NULL) {
+            continue;
+        }
+        test_runs(vector[i]);
+        test_high_bytes(vector[i]);
+        test_random(vector[i]);
+        printf("%s: checked against scalar\n", vector[i]->name);
+        tested++;
+    }
+    if (tested == 0) {
+        printf("no vector kernels on this machine\n");
+    }
+    return test_finish();
+}
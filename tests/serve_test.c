@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "serve.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+// Drives serve_run through a scripted session, with the client's messages
+// read from memory and the server's written to memory, and compares each
+// reply with the JSON the server should send.
+
+typedef struct {
+    char *text;
+    size_t len;
+    FILE *out;
+    // The replies the server should send, in order.
+    char **expected;
+} Session;
+
+static void session_begin(Session *session) {
+    session->out = open_memstream(&session->text, &session->len);
+    session->expected = NULL;
+}
+
+static void session_send_raw(Session *session, const char *body) {
+    fprintf(session->out, "Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+}
+
+// The script writes JSON with ' for ", to keep it readable.
+static char *unquote(const char *text) {
+    char *json = strdup(text);
+    for (char *c = json; *c != '\0'; c++) {
+        if (*c == '\'') {
+            *c = '"';
+        }
+    }
+    return json;
+}
+
+// Sends `body` and expects `reply` in return, or no reply if it is NULL.
+static void session_exchange(Session *session, const char *body, const char *reply) {
+    char *json = unquote(body);
+    session_send_raw(session, json);
+    free(json);
+    if (reply != NULL) {
+        sb_push(session->expected, unquote(reply));
+    }
+}
+
+// Runs the server over everything sent and checks its replies. Returns its
+// exit status.
+static int session_run(Session *session, const char *name) {
+    fclose(session->out);
+    FILE *in = fmemopen(session->text, session->len, "r");
+    char *output;
+    size_t output_len;
+    FILE *out = open_memstream(&output, &output_len);
+    int status = serve_run(in, out);
+    fclose(in);
+    fclose(out);
+    free(session->text);
+
+    char **replies = NULL;
+    const char *p = output;
+    const char *end = output + output_len;
+    while (p < end) {
+        size_t len;
+        int header;
+        if (sscanf(p, "Content-Length: %zu\r\n\r\n%n", &len, &header) != 1 || p + header + len > end) {
+            EXPECT(false, "unframed output: %s", p);
+            break;
+        }
+        char *body = malloc(len + 1);
+        memcpy(body, p + header, len);
+        body[len] = '\0';
+        sb_push(replies, body);
+        p += header + len;
+    }
+    free(output);
+
+    EXPECT(sb_count(replies) == sb_count(session->expected),
+           "%s: %d replies, want %d",
+           name,
+           sb_count(replies),
+           sb_count(session->expected));
+    for (int i = 0; i < sb_count(replies) && i < sb_count(session->expected); i++) {
+        EXPECT_STR(replies[i], session->expected[i], name);
+    }
+    for (int i = 0; i < sb_count(replies); i++) {
+        free(replies[i]);
+    }
+    sb_free(replies);
+    for (int i = 0; i < sb_count(session->expected); i++) {
+        free(session->expected[i]);
+    }
+    sb_free(session->expected);
+    return status;
+}
+
+#define URI "'uri':'file:///a.ts'"
+#define DOC "'textDocument':{" URI "}"
+#define LOCATION(__start_line, __start_char, __end_line, __end_char) \
+    "{" URI ",'range':{'start':{'line':" #__start_line ",'character':" #__start_char "},'end':{'line':" #__end_line \
+    ",'character':" #__end_char "}}}"
+#define PUBLISH(__diagnostics) \
+    "{'jsonrpc':'2.0','method':'textDocument/publishDiagnostics','params':{" URI ",'diagnostics':[" __diagnostics "]}}"
+
+static const char *const redeclared_a =
+        "{'range':{'start':{'line':3,'character':0},'end':{'line':3,'character':3}},'severity':1,"
+        "'code':'DIAGNOSTIC_REDECLARATION','source':'ts','message':'cannot redeclare a; first declared at 1:1'}";
+
+static void test_session(void) {
+    Session session;
+    session_begin(&session);
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':1,'method':'initialize','params':{}}",
+                     "{'jsonrpc':'2.0','id':1,'result':{'capabilities':{'textDocumentSync':{'openClose':true,'change':2},"
+                     "'definitionProvider':true,'referencesProvider':true,'diagnosticProvider':{'interFileDependencies':false,"
+                     "'workspaceDiagnostics':false}},'serverInfo':{'name':'ts'}}}");
+    session_exchange(&session, "{'jsonrpc':'2.0','method':'initialized','params':{}}", NULL);
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','method':'textDocument/didOpen','params':{'textDocument':{" URI
+                     ",'languageId':'typescript','version':1,'text':'let a = 1;\\ntype T = number;\\nlet b: T = a;\\n'}}}",
+                     PUBLISH(""));
+
+    // The `a` in `= a`, and the `T` in `: T`.
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':2,'method':'textDocument/definition','params':{" DOC
+                     ",'position':{'line':2,'character':11}}}",
+                     "{'jsonrpc':'2.0','id':2,'result':" LOCATION(0, 4, 0, 5) "}");
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':3,'method':'textDocument/definition','params':{" DOC
+                     ",'position':{'line':2,'character':7}}}",
+                     "{'jsonrpc':'2.0','id':3,'result':" LOCATION(1, 5, 1, 6) "}");
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':4,'method':'textDocument/references','params':{" DOC
+                     ",'position':{'line':0,'character':4},'context':{'includeDeclaration':true}}}",
+                     "{'jsonrpc':'2.0','id':4,'result':[" LOCATION(0, 4, 0, 5) "," LOCATION(2, 11, 2, 12) "]}");
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':5,'method':'textDocument/references','params':{" DOC
+                     ",'position':{'line':0,'character':4},'context':{'includeDeclaration':false}}}",
+                     "{'jsonrpc':'2.0','id':5,'result':[" LOCATION(2, 11, 2, 12) "]}");
+
+    // Incremental changes: delete the 1 in `let a = 1;`, then put a 2 there
+    // and add a redeclaration at the end in one notification.
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','method':'textDocument/didChange','params':{'textDocument':{" URI
+                     ",'version':2},'contentChanges':[{'range':{'start':{'line':0,'character':8},'end':{'line':0,'character':9}},"
+                     "'text':''}]}}",
+                     PUBLISH("{'range':{'start':{'line':0,'character':8},'end':{'line':0,'character':9}},'severity':1,"
+                             "'code':'DIAGNOSTIC_SYNTAX','source':'ts',"
+                             "'message':'expected identifier or a literal but got TOK_SEMICOLON'}"));
+    char redeclared[1024];
+    snprintf(redeclared, sizeof(redeclared), PUBLISH("%s"), redeclared_a);
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','method':'textDocument/didChange','params':{'textDocument':{" URI
+                     ",'version':3},'contentChanges':[{'range':{'start':{'line':0,'character':8},'end':{'line':0,'character':8}},"
+                     "'text':'2'},{'range':{'start':{'line':3,'character':0},'end':{'line':3,'character':0}},"
+                     "'text':'let a = 3;\\n'}]}}",
+                     redeclared);
+    snprintf(redeclared,
+             sizeof(redeclared), "{'jsonrpc':'2.0','id':6,'result':{'kind':'full','items':[%s]}}", redeclared_a);
+    session_exchange(&session, "{'jsonrpc':'2.0','id':6,'method':'textDocument/diagnostic','params':{" DOC "}}", redeclared);
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':7,'method':'textDocument/references','params':{" DOC
+                     ",'position':{'line':3,'character':4},'context':{'includeDeclaration':true}}}",
+                     "{'jsonrpc':'2.0','id':7,'result':[" LOCATION(0, 4, 0, 5) "," LOCATION(3, 4, 3, 5) "," LOCATION(
+                             2, 11, 2, 12) "]}");
+
+    // A full replacement.
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','method':'textDocument/didChange','params':{'textDocument':{" URI
+                     ",'version':4},'contentChanges':[{'text':'let z = 1;\\nlet y: Q = z;'}]}}",
+                     PUBLISH("{'range':{'start':{'line':1,'character':0},'end':{'line':1,'character':3}},'severity':1,"
+                             "'code':'DIAGNOSTIC_TYPE','source':'ts','message':'cannot find type Q'}"));
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':8,'method':'textDocument/definition','params':{" DOC
+                     ",'position':{'line':1,'character':11}}}",
+                     "{'jsonrpc':'2.0','id':8,'result':" LOCATION(0, 4, 0, 5) "}");
+
+    // Requests the server can't handle.
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':9,'method':'textDocument/hover','params':{" DOC
+                     ",'position':{'line':0,'character':0}}}",
+                     "{'jsonrpc':'2.0','id':9,'error':{'code':-32601,'message':'textDocument/hover'}}");
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':10}",
+                     "{'jsonrpc':'2.0','id':10,'error':{'code':-32600,'message':'missing method'}}");
+    session_exchange(&session, "{bad", "{'jsonrpc':'2.0','id':null,'error':{'code':-32700,'message':'invalid JSON'}}");
+    // Nested deeper than the JSON parser allows.
+    char nested[601];
+    memset(nested, '[', 300);
+    memset(nested + 300, ']', 300);
+    nested[600] = '\0';
+    session_exchange(&session, nested, "{'jsonrpc':'2.0','id':null,'error':{'code':-32700,'message':'invalid JSON'}}");
+
+    session_exchange(&session, "{'jsonrpc':'2.0','method':'textDocument/didClose','params':{" DOC "}}", PUBLISH(""));
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':11,'method':'textDocument/diagnostic','params':{" DOC "}}",
+                     "{'jsonrpc':'2.0','id':11,'result':{'kind':'full','items':[]}}");
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','id':12,'method':'shutdown'}",
+                     "{'jsonrpc':'2.0','id':12,'result':null}");
+    session_exchange(&session, "{'jsonrpc':'2.0','method':'exit'}", NULL);
+    // Never read: the server stops at exit.
+    session_exchange(&session, "{'jsonrpc':'2.0','id':13,'method':'shutdown'}", NULL);
+
+    int status = session_run(&session, "session");
+    EXPECT(status == 0, "exit after shutdown returned %d", status);
+}
+
+// LSP: exiting without a shutdown, or losing the client, is an error.
+static void test_exit_without_shutdown(void) {
+    Session session;
+    session_begin(&session);
+    session_exchange(&session, "{'jsonrpc':'2.0','method':'exit'}", NULL);
+    int status = session_run(&session, "exit without shutdown");
+    EXPECT(status == 1, "exit without shutdown returned %d", status);
+
+    session_begin(&session);
+    session_exchange(&session,
+                     "{'jsonrpc':'2.0','method':'textDocument/didOpen','params':{'textDocument':{" URI
+                     ",'languageId':'typescript','version':1,'text':'let a = 1;'}}}",
+                     PUBLISH(""));
+    status = session_run(&session, "end of input");
+    EXPECT(status == 1, "end of input returned %d", status);
+}
+
+int main(void) {
+    test_session();
+    test_exit_without_shutdown();
+    return test_finish();
+}
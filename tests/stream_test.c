@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "stream.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+// Differential test of module_parse_streaming against a parse, bind and
+// check of the whole module: both must report the same diagnostics, at the
+// same lines, and declare the same symbols. A streamed module keeps only
+// the first declaration of each kind, so symbols are compared by those.
+
+#define STREAM_TEST_ROUNDS 2000
+
+static char *dump(Module *mod) {
+    char *text;
+    size_t len;
+    FILE *out = open_memstream(&text, &len);
+    Diagnostic *lists[] = {mod->diagnostics, mod->bind_diagnostics, mod->check_diagnostics};
+    for (int i = 0; i < 3; i++) {
+        diagnostics_print(out, "a.ts", mod->source, mod->source_len, mod->line_starts, mod->line_marks, lists[i]);
+    }
+    char *symbols = test_dump_symbols(mod, false);
+    fputs(symbols, out);
+    free(symbols);
+    fclose(out);
+    return text;
+}
+
+// Streams `file`'s contents, or `source` if it is NULL, and compares the
+// result with a whole-module parse. Returns false on a mismatch.
+static bool compare(const char *what, const char *source, size_t len, const SourceFile *file) {
+    Module *streamed = module_create(source, len);
+    StreamResult result = module_parse_streaming(streamed, file, NULL, NULL);
+    module_check(streamed);
+
+    Module *mod = module_create(source, len);
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    ParseResult parse_res = parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    BindResult bind_res = module_bind(mod);
+    module_check(mod);
+
+    char *want = dump(mod);
+    char *got = dump(streamed);
+    bool same = strcmp(got, want) == 0;
+    if (!same) {
+        EXPECT_STR(got, want, what);
+        if (len < 4096) {
+            printf("--- source:\n%.*s\n", (int) len, source);
+        }
+    }
+    EXPECT(result.parse_res == parse_res, "%s: parse result %d, want %d", what, result.parse_res, parse_res);
+    EXPECT(result.bind_res == bind_res, "%s: bind result %d, want %d", what, result.bind_res, bind_res);
+    EXPECT(result.statements == (size_t) sb_count(mod->statements),
+           "%s: %zu statements, want %d",
+           what,
+           result.statements,
+           sb_count(mod->statements));
+    free(want);
+    free(got);
+    module_destroy(mod);
+    module_destroy(streamed);
+    return same && result.parse_res == parse_res && result.bind_res == bind_res;
+}
+
+static const char *const cases[] = {
+        // Lets typed with aliases declared later, once and never.
+        "let x: T = 1;\ntype T = number;\n",
+        "let x: T = 1;\nlet y: T = 2;\nlet z: Q = 3;\ntype T = Q;\n",
+        "let x: T = 1;\ntype T = U;\ntype U = T;\n",
+        // Redeclarations of each kind, and a let and alias sharing a name.
+        "let a = 1;\nlet a = 2;\n\n\nlet a = 3;\n",
+        "type A = number;\ntype A = string;\nlet A: A = 1;\nlet A = 2;\n",
+        "type T = number; let x: T = 1; type T = boolean; let x: T = 2;",
+        // Syntax errors, including at the end of the input.
+        "let = 1;\nlet a: = 2;\nlet b: T = ;\ntype T = number;\n",
+        "let a = 1;\nlet b: T",
+        "let a: number = 1; x = y = a;\n\n\n\nlet",
+        "",
+};
+
+static void test_cases(void) {
+    for (size_t i = 0; i < COUNT(cases); i++) {
+        char what[32];
+        snprintf(what, sizeof(what), "case %zu", i);
+        compare(what, cases[i], strlen(cases[i]), NULL);
+    }
+}
+
+static const char *const names[] = {"A", "B", "C", "D", "number", "string", "boolean", "x", "y", "Q"};
+
+static const char *random_name(void) {
+    return names[(size_t) rand() % COUNT(names)];
+}
+
+// Appends a random statement, or a broken one, to `src`.
+static void append_statement(char **src) {
+    char statement[64];
+    int len = 0;
+    switch (rand() % 6) {
+        case 0:
+            len = snprintf(statement, sizeof(statement), "type %s = %s;", random_name(), random_name());
+            break;
+        case 1:
+            len = snprintf(statement, sizeof(statement), "let %s: %s = %s;", random_name(), random_name(), random_name());
+            break;
+        case 2:
+            len = snprintf(statement, sizeof(statement), "let %s = %d;", random_name(), rand() % 5);
+            break;
+        case 3:
+            len = snprintf(statement, sizeof(statement), "%s = %s = 1;", random_name(), random_name());
+            break;
+        case 4:
+            len = snprintf(statement, sizeof(statement), "let %s: %s = ;", random_name(), random_name());
+            break;
+        default:
+            len = snprintf(statement, sizeof(statement), "let = %s;", random_name());
+            break;
+    }
+    memcpy(sb_add(*src, len), statement, (size_t) len);
+    const char *space = rand() % 3 == 0 ? "\n\n" : rand() % 2 ? "\n" : " ";
+    memcpy(sb_add(*src, (int) strlen(space)), space, strlen(space));
+}
+
+static void test_random(void) {
+    srand(23);
+    for (int round = 0; round < STREAM_TEST_ROUNDS; round++) {
+        char *src = NULL;
+        int statements = rand() % 12 + 1;
+        for (int i = 0; i < statements; i++) {
+            append_statement(&src);
+        }
+        char what[32];
+        snprintf(what, sizeof(what), "round %d", round);
+        bool same = compare(what, src, (size_t) sb_count(src), NULL);
+        sb_free(src);
+        if (!same) {
+            return;
+        }
+    }
+}
+
+// A mapped file larger than the release distance, so the pages behind the
+// parser are dropped and read back while the streamed module is checked.
+static void test_large_file(void) {
+    const char *dir = getenv("TEST_TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/stream_test.XXXXXX", dir != NULL ? dir : "/tmp");
+    int fd = mkstemp(path);
+    FILE *out = fdopen(fd, "w");
+    srand(230);
+    size_t written = 0;
+    for (int i = 0; written < 40 * 1024 * 1024; i++) {
+        int n;
+        if (i % 100000 == 99999) {
+            // A few errors and redeclarations far apart.
+            n = fprintf(out, "let = %d;\nlet v0 = 1;\n", i);
+        } else if (i % 3 == 0) {
+            // Typed with an alias declared a few statements later.
+            n = fprintf(out, "let v%d: T%d = v%d;\n", i, i + 3, i / 2);
+        } else if (i % 3 == 1) {
+            n = fprintf(out, "type T%d = %s;\n", i + 2, i % 7 == 0 ? "Missing" : "number");
+        } else {
+            n = fprintf(out, "v%d = v%d = %d;\n", i / 2, i / 3, i);
+        }
+        written += (size_t) n;
+    }
+    fclose(out);
+
+    SourceFile file;
+    EXPECT(source_file_open(&file, path), "couldn't open %s", path);
+    EXPECT(file.mapped, "%s isn't mapped", path);
+    compare("large file", file.data, file.len, &file);
+    source_file_close(&file);
+    unlink(path);
+}
+
+int main(void) {
+    test_cases();
+    test_random();
+    test_large_file();
+    return test_finish();
+}
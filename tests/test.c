@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "tests/test.h"
+#include "vendor/stretchy_buffer.h"
+
+Module *test_parse(const char *source, size_t len) {
+    Module *mod = module_create(source, len);
+    Lexer *lexer = lexer_create(mod->source, mod->source_len, mod->arena, mod->names);
+    Parser *parser = parser_create(lexer);
+    parser_parse(parser, mod);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return mod;
+}
+
+Module *test_parse_and_bind(const char *source, size_t len) {
+    Module *mod = test_parse(source, len);
+    module_bind(mod);
+    return mod;
+}
+
+static const char *dump_name(const Module *mod, int name) {
+    return name < 0 ? "-" : interner_name(mod->names, name).text;
+}
+
+static void dump_node(FILE *out, const Module *mod, NodeId node) {
+    const Ast *ast = &mod->ast;
+    while (node != AST_NONE) {
+        fprintf(out, "@%zu ", ast_location(ast, node).pos);
+        switch (ast_kind(ast, node)) {
+            case NODE_EXPR_IDENT:
+                fprintf(out, "%s", dump_name(mod, node_name(ast, node)));
+                return;
+            case NODE_EXPR_NUM:
+                fprintf(out, "%.17g", expr_num_value(ast, node));
+                return;
+            case NODE_EXPR_ASSIGNMENT:
+                fprintf(out, "%s = ", dump_name(mod, node_name(ast, node)));
+                node = expr_assignment_value(ast, node);
+                break;
+            case NODE_DECL_LET:
+                fprintf(out, "let %s: %s = ", dump_name(mod, node_name(ast, node)), dump_name(mod, decl_let_type_name(ast, node)));
+                node = decl_let_init(ast, node);
+                break;
+            case NODE_DECL_TYPE_ALIAS:
+                fprintf(out,
+                        "type %s = %s",
+                        dump_name(mod, node_name(ast, node)),
+                        dump_name(mod, decl_type_alias_type_name(ast, node)));
+                return;
+        }
+    }
+}
+
+static void dump_diagnostics(FILE *out, const char *phase, const Diagnostic *diagnostics) {
+    for (int i = 0; i < sb_count(diagnostics); i++) {
+        fprintf(out,
+                "%s %s @%zu %s\n",
+                phase,
+                diagnostic_kind_name(diagnostics[i].kind),
+                diagnostics[i].location.pos,
+                diagnostics[i].message);
+    }
+}
+
+static int compare_lines(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+// Writes `lines` sorted, then frees them.
+static void dump_sorted(FILE *out, char **lines) {
+    if (sb_count(lines) > 0) {
+        qsort(lines, (size_t) sb_count(lines), sizeof(char *), compare_lines);
+    }
+    for (int i = 0; i < sb_count(lines); i++) {
+        fprintf(out, "%s\n", lines[i]);
+        free(lines[i]);
+    }
+    sb_free(lines);
+}
+
+static long dump_pos(const Ast *ast, NodeId node) {
+    return node == AST_NONE ? -1 : (long) ast_location(ast, node).pos;
+}
+
+static void dump_symbols(FILE *out, Module *mod, bool decls) {
+    const Ast *ast = &mod->ast;
+    char **lines = NULL;
+    for (int i = 0; i < scope_symbol_count(mod->locals); i++) {
+        const Symbol *symbol = &mod->locals->symbols[i];
+        char *line;
+        size_t len;
+        FILE *buf = open_memstream(&line, &len);
+        fprintf(buf,
+                "symbol %s value@%ld type@%ld",
+                dump_name(mod, symbol->name),
+                dump_pos(ast, symbol->value_decl),
+                dump_pos(ast, symbol->type_decl));
+        if (decls) {
+            fprintf(buf, " decls");
+            for (int j = 0; j < sb_count(symbol->decls); j++) {
+                fprintf(buf, " @%zu", ast_location(ast, symbol->decls[j]).pos);
+            }
+        }
+        fclose(buf);
+        sb_push(lines, line);
+    }
+    dump_sorted(out, lines);
+}
+
+static void dump_references(FILE *out, Module *mod) {
+    const RefIndex *refs = module_references(mod);
+    char **lines = NULL;
+    for (int name = 0; name < interner_count(mod->names); name++) {
+        if (ref_index_count(refs, name) == 0) {
+            continue;
+        }
+        char *line;
+        size_t len;
+        FILE *buf = open_memstream(&line, &len);
+        fprintf(buf, "uses %s", dump_name(mod, name));
+        RefCursor cursor = ref_index_find(refs, name);
+        size_t pos;
+        while (ref_cursor_next(&cursor, &pos)) {
+            fprintf(buf, " @%zu", pos);
+        }
+        fclose(buf);
+        sb_push(lines, line);
+    }
+    dump_sorted(out, lines);
+}
+
+char *test_dump_module(Module *mod) {
+    char *text;
+    size_t len;
+    FILE *out = open_memstream(&text, &len);
+    for (int i = 0; i < sb_count(mod->statements); i++) {
+        dump_node(out, mod, mod->statements[i]);
+        fprintf(out, "\n");
+    }
+    dump_diagnostics(out, "parse", mod->diagnostics);
+    dump_diagnostics(out, "bind", mod->bind_diagnostics);
+    dump_diagnostics(out, "check", mod->check_diagnostics);
+    if (mod->line_starts != NULL) {
+        fprintf(out, "lines");
+        for (int i = 0; i < sb_count(mod->line_starts); i++) {
+            fprintf(out, " %u", mod->line_starts[i]);
+        }
+        fprintf(out, "\n");
+    }
+    if (mod->bound) {
+        dump_symbols(out, mod, true);
+        dump_references(out, mod);
+    }
+    fclose(out);
+    return text;
+}
+
+char *test_dump_symbols(Module *mod, bool decls) {
+    char *text;
+    size_t len;
+    FILE *out = open_memstream(&text, &len);
+    dump_symbols(out, mod, decls);
+    fclose(out);
+    return text;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bind.h"
+#include "tests/expect.h"
+
+// Parses `source` serially. The module is not bound.
+Module *test_parse(const char *source, size_t len);
+
+// Parses and binds.
+Module *test_parse_and_bind(const char *source, size_t len);
+
+// Everything about a module that two ways of building it should agree on,
+// as text: the statements printed back with positions, the diagnostics of
+// every phase, the line table, the symbols by name and, for a bound module,
+// the uses of each name. Positions are byte offsets. Free the result.
+char *test_dump_module(Module *mod);
+
+// The symbols by name, as test_dump_module prints them. `decls` adds every
+// declaration of each; leave it out for a streamed module, which keeps only
+// the first of each kind. Free the result.
+char *test_dump_symbols(Module *mod, bool decls);
@@ -0,0 +1,226 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tokens.h"
+#include "trace.h"
+#include "vendor/stretchy_buffer.h"
+
+// Both capacities are powers of two so positions can be masked into slots.
+#define TOKEN_LAZY_CAPACITY 512
+#define TOKEN_RING_CAPACITY 8192
+// The lexer thread publishes at least this often, so the parser can start
+// on a batch before the ring is full.
+#define TOKEN_RING_BATCH 256
+#define TOKEN_RING_SPINS 64
+
+// Single-producer, single-consumer ring. The lexer thread writes slots in
+// [tail, tail + capacity) and publishes them by advancing `head`; the parser
+// releases slots it no longer needs by advancing `tail`. Each index is only
+// written by one side, so release/acquire ordering is the only
+// synchronisation needed.
+struct TokenRing_ {
+    Token *slots;
+    Lexer *lexer;
+    pthread_t thread;
+    // Set when the parser stops before the end of the stream.
+    atomic_bool stop;
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+};
+
+const char *token_mode_name(TokenMode mode) {
+    switch (mode) {
+        case TOKEN_MODE_LAZY:
+            return "lazy";
+        case TOKEN_MODE_ARRAY:
+            return "array";
+        case TOKEN_MODE_PIPELINE:
+            return "pipeline";
+        default:
+            return "(unknown)";
+    }
+}
+
+bool token_mode_parse(const char *name, TokenMode *mode) {
+    for (TokenMode m = TOKEN_MODE_LAZY; m <= TOKEN_MODE_PIPELINE; m++) {
+        if (strcmp(name, token_mode_name(m)) == 0) {
+            *mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void token_ring_backoff(int *spins) {
+    if (++*spins >= TOKEN_RING_SPINS) {
+        sched_yield();
+    }
+}
+
+static void *token_ring_run(void *arg) {
+    TokenRing *ring = arg;
+    size_t head = 0;
+    int spins = 0;
+    while (!atomic_load_explicit(&ring->stop, memory_order_relaxed)) {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        size_t space = TOKEN_RING_CAPACITY - (head - tail);
+        if (space == 0) {
+            token_ring_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+
+        size_t contiguous = TOKEN_RING_CAPACITY - (head & (TOKEN_RING_CAPACITY - 1));
+        size_t max = space < contiguous ? space : contiguous;
+        if (max > TOKEN_RING_BATCH) {
+            max = TOKEN_RING_BATCH;
+        }
+        Token *out = &ring->slots[head & (TOKEN_RING_CAPACITY - 1)];
+        size_t count = lexer_scan_batch(ring->lexer, out, max);
+        head += count;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        if (out[count - 1].type == TOK_END_OF_FILE) {
+            break;
+        }
+    }
+    lexer_flush_trace(ring->lexer);
+    return NULL;
+}
+
+void token_cursor_init(TokenCursor *cursor, Lexer *lexer, TokenMode mode) {
+    cursor->pos = 0;
+    cursor->end = 0;
+    cursor->done = false;
+    cursor->mode = mode;
+    cursor->lexer = lexer;
+    cursor->ring = NULL;
+    cursor->stall_ns = 0;
+
+    switch (mode) {
+        case TOKEN_MODE_ARRAY:
+            cursor->tokens = lexer_tokenize(lexer);
+            cursor->mask = SIZE_MAX;
+            cursor->end = sb_count(cursor->tokens);
+            cursor->done = true;
+            lexer_flush_trace(lexer);
+            return;
+        case TOKEN_MODE_PIPELINE: {
+            TokenRing *ring = malloc(sizeof(TokenRing));
+            ring->slots = malloc(TOKEN_RING_CAPACITY * sizeof(Token));
+            ring->lexer = lexer;
+            atomic_init(&ring->stop, false);
+            atomic_init(&ring->head, 0);
+            atomic_init(&ring->tail, 0);
+            cursor->ring = ring;
+            cursor->tokens = ring->slots;
+            cursor->mask = TOKEN_RING_CAPACITY - 1;
+            if (pthread_create(&ring->thread, NULL, token_ring_run, ring) != 0) {
+                // Fall back to scanning on this thread.
+                free(ring->slots);
+                free(ring);
+                token_cursor_init(cursor, lexer, TOKEN_MODE_LAZY);
+                return;
+            }
+            break;
+        }
+        case TOKEN_MODE_LAZY:
+        default:
+            cursor->tokens = malloc(TOKEN_LAZY_CAPACITY * sizeof(Token));
+            cursor->mask = TOKEN_LAZY_CAPACITY - 1;
+            break;
+    }
+    token_cursor_fill(cursor, 0);
+}
+
+void token_cursor_destroy(TokenCursor *cursor) {
+    switch (cursor->mode) {
+        case TOKEN_MODE_ARRAY:
+            sb_free(cursor->tokens);
+            break;
+        case TOKEN_MODE_PIPELINE: {
+            TokenRing *ring = cursor->ring;
+            atomic_store_explicit(&ring->stop, true, memory_order_relaxed);
+            pthread_join(ring->thread, NULL);
+            free(ring->slots);
+            free(ring);
+            break;
+        }
+        case TOKEN_MODE_LAZY:
+        default:
+            free(cursor->tokens);
+            break;
+    }
+}
+
+// The slot before `pos` backs token_cursor_prev(), so it must not be
+// overwritten yet.
+static size_t token_cursor_keep_from(const TokenCursor *cursor) {
+    return cursor->pos > 0 ? cursor->pos - 1 : 0;
+}
+
+static void token_cursor_fill_lazy(TokenCursor *cursor, size_t index) {
+    size_t capacity = cursor->mask + 1;
+    while (index >= cursor->end && !cursor->done) {
+        size_t space = capacity - (cursor->end - token_cursor_keep_from(cursor));
+        size_t contiguous = capacity - (cursor->end & cursor->mask);
+        size_t max = space < contiguous ? space : contiguous;
+        assert(max > 0);
+
+        Token *out = &cursor->tokens[cursor->end & cursor->mask];
+        size_t count = lexer_scan_batch(cursor->lexer, out, max);
+        cursor->end += count;
+        if (out[count - 1].type == TOK_END_OF_FILE) {
+            cursor->done = true;
+            lexer_flush_trace(cursor->lexer);
+        }
+    }
+}
+
+static void token_cursor_fill_ring(TokenCursor *cursor, size_t index) {
+    TokenRing *ring = cursor->ring;
+    atomic_store_explicit(&ring->tail, token_cursor_keep_from(cursor), memory_order_release);
+
+    uint64_t stall_start = 0;
+    int spins = 0;
+    while (index >= cursor->end && !cursor->done) {
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == cursor->end) {
+            if (stall_start == 0) {
+                stall_start = trace_now_ns();
+            }
+            token_ring_backoff(&spins);
+            continue;
+        }
+
+        // Take at most a quarter of the ring at a time so `tail` keeps
+        // moving and the lexer thread is never left waiting on a full ring
+        // for long.
+        size_t step = TOKEN_RING_CAPACITY / 4;
+        cursor->end = head - cursor->end > step ? cursor->end + step : head;
+        if (cursor->tokens[(cursor->end - 1) & cursor->mask].type == TOK_END_OF_FILE) {
+            cursor->done = true;
+        }
+    }
+    if (stall_start != 0) {
+        cursor->stall_ns += trace_now_ns() - stall_start;
+    }
+}
+
+void token_cursor_fill(TokenCursor *cursor, size_t index) {
+    assert(index - token_cursor_keep_from(cursor) <= TOKEN_CURSOR_MAX_LOOKAHEAD + 1);
+    switch (cursor->mode) {
+        case TOKEN_MODE_LAZY:
+            token_cursor_fill_lazy(cursor, index);
+            break;
+        case TOKEN_MODE_PIPELINE:
+            token_cursor_fill_ring(cursor, index);
+            break;
+        case TOKEN_MODE_ARRAY:
+        default:
+            break;
+    }
+}
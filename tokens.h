@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lexer.h"
+
+typedef enum {
+    // Lexed on the parsing thread, a small batch at a time.
+    TOKEN_MODE_LAZY,
+    // Lexed into one array before parsing starts.
+    TOKEN_MODE_ARRAY,
+    // Lexed on a separate thread into a ring buffer the parser drains.
+    TOKEN_MODE_PIPELINE,
+} TokenMode;
+
+typedef struct TokenRing_ TokenRing;
+
+// The parser's view of the token stream: the current token, the one before
+// it, and lookahead of up to TOKEN_CURSOR_MAX_LOOKAHEAD tokens. Indices are
+// absolute; `tokens` is either the whole array or a power-of-two ring.
+typedef struct {
+    Token *tokens;
+    size_t mask;
+    size_t pos;
+    // Tokens before this index have been scanned.
+    size_t end;
+    // The token at end - 1 is TOK_END_OF_FILE.
+    bool done;
+    TokenMode mode;
+    Lexer *lexer;
+    TokenRing *ring;
+    // Time the parser spent waiting on the lexer thread.
+    uint64_t stall_ns;
+} TokenCursor;
+
+#define TOKEN_CURSOR_MAX_LOOKAHEAD 64
+
+const char *token_mode_name(TokenMode mode);
+
+bool token_mode_parse(const char *name, TokenMode *mode);
+
+void token_cursor_init(TokenCursor *cursor, Lexer *lexer, TokenMode mode);
+
+// Joins the lexer thread, if any, and frees the token storage.
+void token_cursor_destroy(TokenCursor *cursor);
+
+// Scans (or waits for) tokens until `index` is available or the stream ends.
+void token_cursor_fill(TokenCursor *cursor, size_t index);
+
+static inline const Token *token_cursor_current(const TokenCursor *cursor) {
+    return &cursor->tokens[cursor->pos & cursor->mask];
+}
+
+// Only valid once the cursor has advanced at least once.
+static inline const Token *token_cursor_prev(const TokenCursor *cursor) {
+    return &cursor->tokens[(cursor->pos - 1) & cursor->mask];
+}
+
+// Returns the token `n` places after the current one, or TOK_END_OF_FILE
+// past the end of the stream.
+static inline const Token *token_cursor_peek(TokenCursor *cursor, size_t n) {
+    size_t index = cursor->pos + n;
+    if (index >= cursor->end) {
+        token_cursor_fill(cursor, index);
+        if (index >= cursor->end) {
+            index = cursor->end - 1;
+        }
+    }
+    return &cursor->tokens[index & cursor->mask];
+}
+
+// Stays put on TOK_END_OF_FILE.
+static inline void token_cursor_advance(TokenCursor *cursor) {
+    if (token_cursor_current(cursor)->type == TOK_END_OF_FILE) {
+        return;
+    }
+    if (++cursor->pos == cursor->end) {
+        token_cursor_fill(cursor, cursor->pos);
+    }
+}
@@ -0,0 +1,136 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "json.h"
+#include "trace.h"
+
+struct Trace_ {
+    FILE *out;
+    pthread_mutex_t lock;
+    uint64_t origin_ns;
+    bool first;
+    atomic_int next_thread;
+};
+
+static _Thread_local Trace *trace_thread_owner_ = NULL;
+static _Thread_local int trace_thread_id_ = 0;
+
+void stats_add(Stats *into, const Stats *from) {
+    into->files += from->files;
+    into->bytes += from->bytes;
+    into->tokens += from->tokens;
+    into->statements += from->statements;
+    into->symbols += from->symbols;
+    into->allocations += from->allocations;
+    into->arena_bytes += from->arena_bytes;
+    into->cache_hits += from->cache_hits;
+    into->lex_ns += from->lex_ns;
+    into->parse_ns += from->parse_ns;
+    into->bind_ns += from->bind_ns;
+    into->check_ns += from->check_ns;
+    into->emit_ns += from->emit_ns;
+}
+
+void stats_print(FILE *out, const Stats *stats, uint64_t wall_ns) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(out, "files:       %zu (%zu bytes)\n", stats->files, stats->bytes);
+    fprintf(out, "wall:        %.3f ms\n", (double) wall_ns / 1e6);
+    fprintf(out, "lex:         %.3f ms\n", (double) stats->lex_ns / 1e6);
+    fprintf(out, "parse:       %.3f ms\n", (double) stats->parse_ns / 1e6);
+    fprintf(out, "bind:        %.3f ms\n", (double) stats->bind_ns / 1e6);
+    fprintf(out, "check:       %.3f ms\n", (double) stats->check_ns / 1e6);
+    fprintf(out, "emit:        %.3f ms\n", (double) stats->emit_ns / 1e6);
+    fprintf(out, "tokens:      %zu\n", stats->tokens);
+    fprintf(out, "statements:  %zu\n", stats->statements);
+    fprintf(out, "symbols:     %zu\n", stats->symbols);
+    fprintf(out, "cache hits:  %zu\n", stats->cache_hits);
+    fprintf(out, "allocations: %zu arena (%zu bytes in chunks)\n", stats->allocations, stats->arena_bytes);
+    // ru_maxrss is in kilobytes on Linux.
+    fprintf(out, "peak rss:    %ld KB\n", usage.ru_maxrss);
+}
+
+uint64_t trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+Trace *trace_open(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        return NULL;
+    }
+
+    Trace *trace = malloc(sizeof(Trace));
+    trace->out = out;
+    pthread_mutex_init(&trace->lock, NULL);
+    trace->origin_ns = trace_now_ns();
+    trace->first = true;
+    atomic_init(&trace->next_thread, 0);
+    fprintf(out, "{\"traceEvents\": [\n");
+    return trace;
+}
+
+void trace_close(Trace *trace) {
+    fprintf(trace->out, "\n]}\n");
+    fclose(trace->out);
+    pthread_mutex_destroy(&trace->lock);
+    free(trace);
+}
+
+static void trace_separator(Trace *trace) {
+    if (!trace->first) {
+        fprintf(trace->out, ",\n");
+    }
+    trace->first = false;
+}
+
+static void trace_name_track(Trace *trace, int tid, const char *name) {
+    trace_separator(trace);
+    fprintf(trace->out,
+            "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ",
+            tid);
+    json_write_string(trace->out, name, strlen(name));
+    fprintf(trace->out, "}}");
+}
+
+// Called with the lock held.
+static int trace_thread_id(Trace *trace) {
+    if (trace_thread_owner_ != trace) {
+        trace_thread_owner_ = trace;
+        trace_thread_id_ = atomic_fetch_add(&trace->next_thread, 1);
+
+        char name[64];
+        snprintf(name, sizeof(name), "thread %d", trace_thread_id_);
+        trace_name_track(trace, trace_thread_id_ * 2, name);
+        snprintf(name, sizeof(name), "thread %d lexer", trace_thread_id_);
+        trace_name_track(trace, trace_thread_id_ * 2 + 1, name);
+    }
+    return trace_thread_id_;
+}
+
+void trace_span(Trace *trace, TraceTrack track, const char *name, uint64_t start_ns, uint64_t end_ns, const char *detail) {
+    pthread_mutex_lock(&trace->lock);
+    int tid = trace_thread_id(trace) * 2 + (track == TRACE_TRACK_LEXER ? 1 : 0);
+    trace_separator(trace);
+    fprintf(trace->out, "{\"name\": ");
+    json_write_string(trace->out, name, strlen(name));
+    fprintf(trace->out,
+            ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+            tid,
+            (double) (start_ns - trace->origin_ns) / 1e3,
+            (double) (end_ns - start_ns) / 1e3);
+    if (detail != NULL) {
+        fprintf(trace->out, ", \"args\": {\"detail\": ");
+        json_write_string(trace->out, detail, strlen(detail));
+        fprintf(trace->out, "}");
+    }
+    fprintf(trace->out, "}");
+    pthread_mutex_unlock(&trace->lock);
+}
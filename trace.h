@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    size_t files;
+    size_t bytes;
+    size_t tokens;
+    size_t statements;
+    size_t symbols;
+    size_t allocations;
+    size_t arena_bytes;
+    size_t cache_hits;
+    // Summed over every thread that did the work.
+    uint64_t lex_ns;
+    uint64_t parse_ns;
+    uint64_t bind_ns;
+    uint64_t check_ns;
+    uint64_t emit_ns;
+} Stats;
+
+void stats_add(Stats *into, const Stats *from);
+
+void stats_print(FILE *out, const Stats *stats, uint64_t wall_ns);
+
+// Writes Chrome trace-event JSON. Spans from any thread may be recorded
+// concurrently; each thread gets its own pair of tracks.
+typedef struct Trace_ Trace;
+
+typedef enum {
+    TRACE_TRACK_MAIN,
+    // Lexing is interleaved with parsing (or runs on its own thread), so
+    // lexer batches go on a separate track with their duration set to the
+    // time spent inside lexer_scan_batch.
+    TRACE_TRACK_LEXER,
+} TraceTrack;
+
+Trace *trace_open(const char *path);
+
+void trace_close(Trace *trace);
+
+uint64_t trace_now_ns(void);
+
+void trace_span(Trace *trace, TraceTrack track, const char *name, uint64_t start_ns, uint64_t end_ns, const char *detail);
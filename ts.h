@@ -0,0 +1,76 @@
+#pragma once
+
+// The compiler as a library. Everything a context creates belongs to it
+// and is freed with it. Contexts share no state, so any number of threads
+// can each work in their own; a single context must not be used from two
+// threads at once.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct TsContext TsContext;
+
+// One parsed source buffer.
+typedef struct TsModule TsModule;
+
+typedef enum {
+    TS_DIAGNOSTIC_SYNTAX,
+    TS_DIAGNOSTIC_REDECLARATION,
+    TS_DIAGNOSTIC_TYPE,
+} TsDiagnosticKind;
+
+typedef struct {
+    TsDiagnosticKind kind;
+    // Byte offset into the source, and its 1-based line and byte column.
+    size_t offset;
+    size_t line;
+    size_t column;
+    // Valid until the module is checked again or the context is destroyed.
+    const char *message;
+} TsDiagnostic;
+
+// A top-level name and where it was first declared.
+typedef struct {
+    // NUL-terminated; valid until the context is destroyed.
+    const char *name;
+    size_t name_len;
+    // Declared by a let, and by a type alias, respectively.
+    bool is_value;
+    bool is_type;
+    int declarations;
+    size_t offset;
+    size_t line;
+    size_t column;
+} TsSymbol;
+
+TsContext *ts_context_create(void);
+
+// Frees the context and every module parsed in it.
+void ts_context_destroy(TsContext *ctx);
+
+// Parses `source`, which is not copied and must stay valid until the
+// context is destroyed. Syntax errors are recovered from and reported as
+// diagnostics. Returns NULL if the source is too large to parse.
+TsModule *ts_parse(TsContext *ctx, const char *source, size_t source_len);
+
+// Declares every top-level statement. Returns false if anything was
+// redeclared. Binding again does nothing.
+bool ts_bind(TsModule *mod);
+
+// Binds the module if needed and resolves every type it uses. Returns false
+// if a type is unknown or circular.
+bool ts_check(TsModule *mod);
+
+// Syntax errors, then redeclarations, then type errors, each in source
+// order. Only those of the phases run so far are included.
+int ts_diagnostic_count(const TsModule *mod);
+
+// `index` must be less than ts_diagnostic_count.
+TsDiagnostic ts_diagnostic(const TsModule *mod, int index);
+
+// The top-level symbols of a bound module, in no particular order; 0 if
+// the module isn't bound.
+int ts_symbol_count(const TsModule *mod);
+
+// `index` must be less than ts_symbol_count.
+TsSymbol ts_symbol(const TsModule *mod, int index);